@@ -0,0 +1,197 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "certstore.h"
+
+#include "qfreerdp.h"
+#include <QCryptographicHash>
+#include <QRegularExpression>
+#include <QSslCertificate>
+#include <QSslSocket>
+#include <QTimer>
+
+/* TPKT header, X.224 Connection Request and RDP_NEG_REQ asking for TLS or
+ * CredSSP (which also starts with TLS), without a routing cookie */
+static const char s_connectionRequest[] = {
+    0x03, 0x00, 0x00, 0x13,
+    0x0e, char(0xe0), 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x08, 0x00, 0x03, 0x00, 0x00, 0x00
+};
+
+static const int s_fetchTimeout = 10000;
+
+QString normalizeFingerprint(const QString &fingerprint)
+{
+    static const QRegularExpression re_separators("[^0-9A-Fa-f]");
+    return QString(fingerprint).remove(re_separators).toLower();
+}
+
+bool certificateAccepted(const CertificateCheck &check, CertPolicy policy,
+                         const QString &knownFingerprint, QString *reason)
+{
+    if (!check.fetched) {
+        *reason = check.error;
+        return false;
+    }
+
+    const QString known = normalizeFingerprint(knownFingerprint);
+    switch (policy) {
+    case CP_Ask:
+        return true;
+    case CP_TrustOnFirstUse:
+        if (known.isEmpty() || known == check.fingerprint)
+            return true;
+        *reason = QObject::tr("The certificate has changed since it was first trusted");
+        return false;
+    case CP_Pinned:
+        if (known.isEmpty()) {
+            *reason = QObject::tr("No fingerprint has been pinned");
+            return false;
+        }
+        if (known == check.fingerprint)
+            return true;
+        *reason = QObject::tr("The certificate does not match the pinned fingerprint");
+        return false;
+    case CP_CertificateAuthority:
+        if (check.errors.isEmpty())
+            return true;
+        *reason = check.errors.first().errorString();
+        return false;
+    }
+    return false;
+}
+
+CertificateFetcher::CertificateFetcher(QObject *parent)
+    : QObject(parent), m_socket(Q_NULLPTR), m_port(0)
+{
+    m_timeout = new QTimer(this);
+    m_timeout->setSingleShot(true);
+    connect(m_timeout, &QTimer::timeout, [this]()
+    {
+        fail(tr("Timed out fetching the certificate"));
+    });
+}
+
+void CertificateFetcher::fetch(const QString &host, quint16 port, const QString &peerName)
+{
+    if (m_socket) {
+        m_socket->disconnect(this);
+        m_socket->abort();
+        m_socket->deleteLater();
+    }
+
+    m_host = host;
+    m_port = port;
+    m_peerName = peerName;
+    m_result = CertificateCheck();
+    m_elapsed.start();
+    m_timeout->start(s_fetchTimeout);
+
+    m_socket = new QSslSocket(this);
+    m_socket->setPeerVerifyName(peerName);
+    connect(m_socket, &QSslSocket::connected, this, &CertificateFetcher::sendConnectionRequest);
+    connect(m_socket, &QSslSocket::readyRead, this, &CertificateFetcher::readConnectionConfirm);
+    connect(m_socket, &QSslSocket::encrypted, this, &CertificateFetcher::handshakeDone);
+    connect(m_socket, QOverload<const QList<QSslError> &>::of(&QSslSocket::sslErrors),
+            this, &CertificateFetcher::recordSslErrors);
+    connect(m_socket, SIGNAL(error(QAbstractSocket::SocketError)), SLOT(socketError()));
+    m_socket->connectToHost(host, port);
+}
+
+void CertificateFetcher::sendConnectionRequest()
+{
+    m_socket->write(s_connectionRequest, sizeof(s_connectionRequest));
+}
+
+void CertificateFetcher::readConnectionConfirm()
+{
+    // Once encryption starts, the handshake is Qt's business
+    if (m_socket->mode() != QSslSocket::UnencryptedMode)
+        return;
+
+    QByteArray header = m_socket->peek(4);
+    if (header.size() < 4)
+        return;
+    if (header.at(0) != 0x03) {
+        fail(tr("Not an RDP server"));
+        return;
+    }
+    int length = (static_cast<uchar>(header.at(2)) << 8) | static_cast<uchar>(header.at(3));
+    if (m_socket->bytesAvailable() < length)
+        return;
+
+    // TPKT, then X.224 Connection Confirm, then RDP_NEG_RSP or _FAILURE
+    QByteArray confirm = m_socket->read(length);
+    if (length < 11 || static_cast<uchar>(confirm.at(5)) != 0xd0) {
+        fail(tr("Not an RDP server"));
+        return;
+    }
+    if (length < 19 || confirm.at(11) != 0x02) {
+        fail(tr("The server does not offer TLS"));
+        return;
+    }
+
+    m_socket->startClientEncryption();
+}
+
+void CertificateFetcher::handshakeDone()
+{
+    QSslCertificate certificate = m_socket->peerCertificate();
+    m_result.fetched = !certificate.isNull();
+    if (m_result.fetched)
+        m_result.fingerprint = QString::fromLatin1(
+                    certificate.digest(QCryptographicHash::Sha256).toHex());
+    else
+        m_result.error = tr("The server did not present a certificate");
+    finish();
+}
+
+void CertificateFetcher::recordSslErrors(const QList<QSslError> &errors)
+{
+    // We only want to look at the certificate, so let the handshake
+    // finish and judge the errors against the policy afterwards
+    m_result.errors = errors;
+    m_socket->ignoreSslErrors();
+}
+
+void CertificateFetcher::socketError()
+{
+    fail(m_socket->errorString());
+}
+
+void CertificateFetcher::fail(const QString &error)
+{
+    if (!m_socket)
+        return;
+    m_result.fetched = false;
+    m_result.error = error;
+    finish();
+}
+
+void CertificateFetcher::finish()
+{
+    if (!m_socket)
+        return;
+
+    m_timeout->stop();
+    m_result.msecs = m_elapsed.elapsed();
+    m_socket->disconnect(this);
+    m_socket->abort();
+    m_socket->deleteLater();
+    m_socket = Q_NULLPTR;
+    emit finished();
+}
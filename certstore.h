@@ -0,0 +1,97 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _QFREERDP_CERTSTORE_H
+#define _QFREERDP_CERTSTORE_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QSslError>
+
+class QSslSocket;
+class QTimer;
+
+enum CertPolicy
+{
+    CP_Ask,                 // Leave it to the client, which may prompt
+    CP_TrustOnFirstUse,
+    CP_Pinned,
+    CP_CertificateAuthority
+};
+
+struct CertificateCheck
+{
+    CertificateCheck() : fetched(false), msecs(-1) { }
+
+    bool fetched;
+    QString error;
+    QString fingerprint;        // SHA-256, lower case hex without separators
+    QList<QSslError> errors;    // Validation against the system CAs
+    qint64 msecs;
+};
+
+/* Accepts fingerprints with or without separators, in either case */
+QString normalizeFingerprint(const QString &fingerprint);
+
+/* Decides whether a fetched certificate may be used without asking.  For
+ * trust on first use, an empty known fingerprint means it's the first. */
+bool certificateAccepted(const CertificateCheck &check, CertPolicy policy,
+                         const QString &knownFingerprint, QString *reason);
+
+/* Fetches a server's TLS certificate the same way the client will see it:
+ * an X.224 connection request asking for TLS, then the TLS handshake.
+ * Nothing is authenticated, so this can run while the user is still
+ * typing their password. */
+class CertificateFetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CertificateFetcher(QObject *parent = Q_NULLPTR);
+
+    void fetch(const QString &host, quint16 port, const QString &peerName);
+    bool isRunning() const { return m_socket != Q_NULLPTR; }
+
+    QString host() const { return m_host; }
+    quint16 port() const { return m_port; }
+    QString peerName() const { return m_peerName; }
+    CertificateCheck result() const { return m_result; }
+
+signals:
+    void finished();
+
+private slots:
+    void sendConnectionRequest();
+    void readConnectionConfirm();
+    void handshakeDone();
+    void recordSslErrors(const QList<QSslError> &errors);
+    void socketError();
+    void fail(const QString &error);
+
+private:
+    QSslSocket *m_socket;
+    QTimer *m_timeout;
+    QString m_host;
+    quint16 m_port;
+    QString m_peerName;
+    QElapsedTimer m_elapsed;
+    CertificateCheck m_result;
+
+    void finish();
+};
+
+#endif
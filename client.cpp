@@ -0,0 +1,175 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "client.h"
+
+#include "qfreerdp.h"
+#include <QRegularExpression>
+#include <QSettings>
+#include <QStandardPaths>
+#include <sys/resource.h>
+
+static const QRegularExpression re_version("FreeRDP version ([0-9.]*)");
+
+static const char *s_clients[] = {
+    "xfreerdp",
+    "xfreerdp3",
+    "sdl-freerdp",
+    "sdl-freerdp3"
+};
+
+/* Option syntax for FreeRDP 2.x and 3.x, indexed by ClientOption.  %1 is
+ * replaced by the value, or by +/- for toggles.  Entries starting with '@'
+ * are sub-options which get merged into a single /group:a,b,c parameter,
+ * and use on/off for toggles.  A null entry means the client has no such
+ * option and it is left out: FreeRDP 2.x can't pin a fingerprint, so it
+ * does its own verification rather than being told to skip it. */
+struct OptionSyntax
+{
+    const char *freerdp2;
+    const char *freerdp3;
+};
+
+static const OptionSyntax s_optionSyntax[] = {
+    /* CO_Server */             { "/v:%1",                  "/v:%1" },
+    /* CO_Username */           { "/u:%1",                  "/u:%1" },
+    /* CO_Password */           { "/p:%1",                  "/p:%1" },
+    /* CO_Size */               { "/size:%1",               "/size:%1" },
+    /* CO_Fullscreen */         { "/f",                     "/f" },
+    /* CO_RemoteApp */          { "/app:%1",                "@app:program:%1" },
+    /* CO_RemoteAppArgs */      { "/app-cmd:%1",            "@app:cmd:%1" },
+    /* CO_RemoteAppDirectory */ { "/shell-dir:%1",          "@app:workdir:%1" },
+    /* CO_BitDepth */           { "/bpp:%1",                "/bpp:%1" },
+    /* CO_Compression */        { "%1compression",          "%1compression" },
+    /* CO_CompressionLevel */   { "/compression-level:%1",  "/compression-level:%1" },
+    /* CO_Jpeg */               { "/jpeg",                  "/jpeg" },
+    /* CO_JpegQuality */        { "/jpeg-quality:%1",       "/jpeg-quality:%1" },
+    /* CO_AudioMode */          { "/audio-mode:%1",         "/audio-mode:%1" },
+    /* CO_Clipboard */          { "%1clipboard",            "%1clipboard" },
+    /* CO_Drives */             { "%1drives",               "%1drives" },
+    /* CO_HomeDrive */          { "%1home-drive",           "%1home-drive" },
+    /* CO_Fonts */              { "%1fonts",                "%1fonts" },
+    /* CO_Aero */               { "%1aero",                 "%1aero" },
+    /* CO_WindowDrag */         { "%1window-drag",          "%1window-drag" },
+    /* CO_MenuAnims */          { "%1menu-anims",           "%1menu-anims" },
+    /* CO_Themes */             { "%1themes",               "%1themes" },
+    /* CO_Wallpaper */          { "%1wallpaper",            "%1wallpaper" },
+    /* CO_BitmapCache */        { "%1bitmap-cache",         "@cache:bitmap:%1" },
+    /* CO_OffscreenCache */     { "%1offscreen-cache",      "@cache:offscreen:%1" },
+    /* CO_GlyphCache */         { "%1glyph-cache",          "@cache:glyph:%1" },
+    /* CO_Gateway */            { "/g:%1",                  "@gateway:g:%1" },
+    /* CO_GatewayUsername */    { "/gu:%1",                 "@gateway:u:%1" },
+    /* CO_GatewayPassword */    { "/gp:%1",                 "@gateway:p:%1" },
+    /* CO_CertName */           { "/cert-name:%1",          "@cert:name:%1" },
+    /* CO_CertFingerprint */    { Q_NULLPTR,                "@cert:fingerprint:sha256:%1" },
+    /* CO_Pcap */               { "/pcap:%1",               "/pcap:%1" },
+    /* CO_PlayRfx */            { "/play-rfx:%1",           "/play-rfx:%1" },
+};
+
+QStringList availableClients()
+{
+    QStringList result;
+    for (const char *client : s_clients) {
+        QString program = QString::fromLatin1(client);
+        if (!QStandardPaths::findExecutable(program).isEmpty())
+            result.append(program);
+    }
+    return result;
+}
+
+QString defaultClient()
+{
+    QString program = QString::fromLocal8Bit(qgetenv("QFREERDP_XFREERDP"));
+    if (!program.isEmpty())
+        return program;
+
+    QSettings settings(QStringLiteral("qfreerdp"), QStringLiteral("qfreerdp"));
+    program = settings.value(QStringLiteral("Client")).toString();
+    if (!program.isEmpty())
+        return program;
+
+    QStringList clients = availableClients();
+    return clients.isEmpty() ? QStringLiteral("xfreerdp") : clients.first();
+}
+
+bool probeClient(const QString &program, ClientInfo *info)
+{
+    info->program = program;
+    info->version.clear();
+    info->major = 0;
+
+    auto result = queryXFreeRDP(program, QStringLiteral("--version"));
+    if (!result.second)
+        return false;
+    for (QByteArray line : result.first.split('\n')) {
+        auto strLine = QString::fromLocal8Bit(line);
+        auto match = re_version.match(strLine);
+        if (!match.hasMatch())
+            continue;
+        info->version = match.captured(1);
+        info->major = info->version.section(QLatin1Char('.'), 0, 0).toInt();
+        break;
+    }
+    return true;
+}
+
+double childCpuMsecs()
+{
+    rusage usage;
+    getrusage(RUSAGE_CHILDREN, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0
+            + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+}
+
+void ClientOptions::add(ClientOption option, const QString &value)
+{
+    const char *syntax = (m_major >= 3) ? s_optionSyntax[option].freerdp3
+                                        : s_optionSyntax[option].freerdp2;
+    if (!syntax)
+        return;
+
+    QString param = QString::fromLatin1(syntax);
+    if (param.contains(QStringLiteral("%1")))
+        param = param.arg(value);
+    if (!param.startsWith(QLatin1Char('@'))) {
+        m_params.append(param);
+        return;
+    }
+
+    int split = param.indexOf(QLatin1Char(':'));
+    QString group = param.mid(1, split - 1);
+    QString item = param.mid(split + 1);
+    auto iter = m_groups.constFind(group);
+    if (iter == m_groups.constEnd()) {
+        m_groups.insert(group, m_params.size());
+        m_params.append(QStringLiteral("/%1:%2").arg(group, item));
+    } else {
+        m_params[*iter] += QLatin1Char(',') + item;
+    }
+}
+
+void ClientOptions::toggle(ClientOption option, bool enabled)
+{
+    const char *syntax = (m_major >= 3) ? s_optionSyntax[option].freerdp3
+                                        : s_optionSyntax[option].freerdp2;
+    if (!syntax)
+        return;
+    if (syntax[0] == '@')
+        add(option, enabled ? QStringLiteral("on") : QStringLiteral("off"));
+    else
+        add(option, enabled ? QStringLiteral("+") : QStringLiteral("-"));
+}
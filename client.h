@@ -0,0 +1,103 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _QFREERDP_CLIENT_H
+#define _QFREERDP_CLIENT_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+
+struct ClientInfo
+{
+    ClientInfo() : major(0) { }
+
+    QString program;
+    QString version;
+    int major;          // 0 if the version could not be determined
+};
+
+/* Client executables we know how to drive, in order of preference */
+QStringList availableClients();
+
+/* The client to use when the user hasn't picked one: $QFREERDP_XFREERDP
+ * if set, then the Client setting, then the first one found in PATH */
+QString defaultClient();
+
+/* Returns false if the client could not be started at all */
+bool probeClient(const QString &program, ClientInfo *info);
+
+/* CPU time used by all child processes which have been waited for */
+double childCpuMsecs();
+
+enum ClientOption
+{
+    CO_Server,
+    CO_Username,
+    CO_Password,
+    CO_Size,
+    CO_Fullscreen,
+    CO_RemoteApp,
+    CO_RemoteAppArgs,
+    CO_RemoteAppDirectory,
+    CO_BitDepth,
+    CO_Compression,
+    CO_CompressionLevel,
+    CO_Jpeg,
+    CO_JpegQuality,
+    CO_AudioMode,
+    CO_Clipboard,
+    CO_Drives,
+    CO_HomeDrive,
+    CO_Fonts,
+    CO_Aero,
+    CO_WindowDrag,
+    CO_MenuAnims,
+    CO_Themes,
+    CO_Wallpaper,
+    CO_BitmapCache,
+    CO_OffscreenCache,
+    CO_GlyphCache,
+    CO_Gateway,
+    CO_GatewayUsername,
+    CO_GatewayPassword,
+    CO_CertName,
+    CO_CertFingerprint,
+    CO_Pcap,
+    CO_PlayRfx
+};
+
+/* Builds a command line for a specific FreeRDP major version, translating
+ * each launcher setting to the syntax that version understands */
+class ClientOptions
+{
+public:
+    explicit ClientOptions(int majorVersion) : m_major(majorVersion) { }
+
+    void add(ClientOption option, const QString &value = QString());
+    void toggle(ClientOption option, bool enabled);
+    void append(const QStringList &params) { m_params.append(params); }
+
+    QStringList params() const { return m_params; }
+
+private:
+    int m_major;
+    QStringList m_params;
+    QHash<QString, int> m_groups;
+};
+
+#endif
@@ -0,0 +1,145 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "history.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+
+/* Only recent sessions count, so the recommendation follows changes on
+ * the server side.  A combination needs a few sessions to be trusted. */
+static const int s_recentSessions = 100;
+static const int s_minSessions = 3;
+
+static QString historyPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+            + QStringLiteral("/history.dat");
+}
+
+void appendSessionRecord(const SessionRecord &record)
+{
+    QString path = historyPath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
+        return;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << record.server << record.started << record.connectMsecs << record.duration
+           << record.abnormal << record.bytesSent << record.bytesReceived << record.settings;
+}
+
+static QHash<QString, QList<SessionRecord>> loadSessionHistory()
+{
+    QHash<QString, QList<SessionRecord>> history;
+    QFile file(historyPath());
+    if (!file.open(QIODevice::ReadOnly))
+        return history;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    while (!stream.atEnd()) {
+        SessionRecord record;
+        stream >> record.server >> record.started >> record.connectMsecs >> record.duration
+               >> record.abnormal >> record.bytesSent >> record.bytesReceived
+               >> record.settings;
+        if (stream.status() != QDataStream::Ok)
+            break;
+        history[record.server].append(record);
+    }
+    return history;
+}
+
+QHash<QString, QList<SessionRecord>> sessionHistory()
+{
+    static QHash<QString, QList<SessionRecord>> s_history;
+    static qint64 s_size = -1;
+    static QDateTime s_modified;
+
+    QFileInfo info(historyPath());
+    if (info.size() != s_size || info.lastModified() != s_modified) {
+        s_history = loadSessionHistory();
+        s_size = info.size();
+        s_modified = info.lastModified();
+    }
+    return s_history;
+}
+
+struct SettingsStats
+{
+    SettingsStats()
+        : sessions(0), abnormal(0), duration(0), connectMsecs(0), connectSamples(0) { }
+
+    int sessions;
+    int abnormal;
+    qint64 duration;
+    qint64 connectMsecs;
+    int connectSamples;
+
+    double abnormalRate() const { return double(abnormal) / sessions; }
+    double meanDuration() const { return double(duration) / sessions; }
+    double meanConnect() const { return double(connectMsecs) / connectSamples; }
+};
+
+static bool betterStats(const SettingsStats &a, const SettingsStats &b)
+{
+    // Reliability matters most.  Between similarly reliable settings, prefer
+    // faster connections where we know them, and otherwise whichever the
+    // user tends to stay connected with for longer.
+    if (qAbs(a.abnormalRate() - b.abnormalRate()) > 0.05)
+        return a.abnormalRate() < b.abnormalRate();
+    if (a.connectSamples > 0 && b.connectSamples > 0)
+        return a.meanConnect() < b.meanConnect();
+    return a.meanDuration() > b.meanDuration();
+}
+
+bool recommendSettings(const QList<SessionRecord> &history, quint32 *settings,
+                       int *sessions, int *abnormal)
+{
+    QHash<quint32, SettingsStats> stats;
+    for (const SessionRecord &record : history.mid(qMax(0, history.size() - s_recentSessions))) {
+        SettingsStats &entry = stats[record.settings];
+        entry.sessions += 1;
+        entry.duration += record.duration;
+        if (record.abnormal)
+            entry.abnormal += 1;
+        if (record.connectMsecs >= 0) {
+            entry.connectMsecs += record.connectMsecs;
+            entry.connectSamples += 1;
+        }
+    }
+
+    const SettingsStats *best = Q_NULLPTR;
+    for (auto iter = stats.constBegin(); iter != stats.constEnd(); ++iter) {
+        if (iter->sessions < s_minSessions)
+            continue;
+        if (!best || betterStats(*iter, *best)) {
+            best = &iter.value();
+            *settings = iter.key();
+        }
+    }
+    if (!best)
+        return false;
+    *sessions = best->sessions;
+    *abnormal = best->abnormal;
+    return true;
+}
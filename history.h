@@ -0,0 +1,49 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _QFREERDP_HISTORY_H
+#define _QFREERDP_HISTORY_H
+
+#include <QString>
+#include <QList>
+#include <QHash>
+
+struct SessionRecord
+{
+    QString server;
+    qint64 started;         // Seconds since epoch
+    qint32 connectMsecs;    // -1 if unknown
+    qint32 duration;        // Seconds
+    bool abnormal;
+    qint64 bytesSent;       // Client to server, or -1 if unknown
+    qint64 bytesReceived;   // Server to client, or -1 if unknown
+    quint32 settings;       // Packed launcher settings, see Launcher::settingsKey()
+};
+
+void appendSessionRecord(const SessionRecord &record);
+
+/* All recorded sessions by server.  The file is only read again when it
+ * has changed since the last call. */
+QHash<QString, QList<SessionRecord>> sessionHistory();
+
+/* Picks the settings combination which has worked best for a server, based
+ * on at least a few sessions' worth of history.  Returns false if there is
+ * not enough data to make a recommendation. */
+bool recommendSettings(const QList<SessionRecord> &history, quint32 *settings,
+                       int *sessions, int *abnormal);
+
+#endif
@@ -18,12 +18,24 @@
 #include "launcher.h"
 
 #include "qfreerdp.h"
+#include "certstore.h"
+#include "client.h"
+#include "history.h"
+#include "memory.h"
+#include "params.h"
+#include "profiles.h"
+#include "relay.h"
+#include "replay.h"
+#include "session.h"
+#include "sshtunnel.h"
+#include "trace.h"
 #include <QLabel>
 #include <QLineEdit>
 #include <QComboBox>
 #include <QCheckBox>
 #include <QPushButton>
 #include <QSlider>
+#include <QSpinBox>
 #include <QGroupBox>
 #include <QTabWidget>
 #include <QGridLayout>
@@ -34,6 +46,7 @@
 #include <QMessageBox>
 #include <QProcess>
 #include <QSettings>
+#include <QTimer>
 
 static QList<QSize> s_standardResolutions {
     { 640,  480},
@@ -73,6 +86,7 @@ static QList<QSize> s_standardResolutions {
 
 static QList<QSize> getUsableResolutions()
 {
+    TRACE_SCOPE("getUsableResolutions");
     QList<QRect> screens;
     QDesktopWidget *desktop = QApplication::desktop();
     int maxScreens = desktop->screenCount();
@@ -95,11 +109,17 @@ static QList<QSize> getUsableResolutions()
 
 static const QList<int> s_depths { 15, 16, 24, 32 };
 
-Launcher::Launcher()
-    : QDialog(Q_NULLPTR)
+Launcher::Launcher(const ClientInfo &client, ProfileStore *profiles)
+    : QDialog(Q_NULLPTR), m_profiles(profiles), m_resident(false), m_learnedKey(0),
+      m_defaultClient(client.program), m_runningMemory(0), m_session(Q_NULLPTR),
+      m_tunnel(Q_NULLPTR), m_certPending(false), m_pendingPort(0),
+      m_certTraceBegin(0)
 {
-    QTabWidget *tabs = new QTabWidget(this);
-    tabs->setUsesScrollButtons(false);
+    TRACE_SCOPE("Launcher::Launcher");
+    m_clientInfo.insert(client.program, client);
+
+    m_tabs = new QTabWidget(this);
+    m_tabs->setUsesScrollButtons(false);
 
     QWidget *generalTab = new QWidget(this);
     QGroupBox *loginGroup = new QGroupBox(tr("Login settings"), this);
@@ -131,7 +151,7 @@ Launcher::Launcher()
     QVBoxLayout *generalLayout = new QVBoxLayout(generalTab);
     generalLayout->addWidget(loginGroup);
     generalLayout->addItem(new QSpacerItem(0, 0, QSizePolicy::Minimum, QSizePolicy::Expanding));
-    tabs->addTab(generalTab, tr("&General"));
+    m_tabs->addTab(generalTab, tr("&General"));
 
     QWidget *displayTab = new QWidget(this);
     QGroupBox *displayGroup = new QGroupBox(tr("Display settings"), this);
@@ -139,7 +159,8 @@ Launcher::Launcher()
     m_resolutionType = new QComboBox(this);
     m_resolutionType->addItems(QStringList { tr("Standard Resolution"),
                                              tr("Custom Resolution"),
-                                             tr("Full Screen") });
+                                             tr("Full Screen"),
+                                             tr("RemoteApp") });
     m_resolution = new QSlider(Qt::Horizontal, this);
     m_resolution->setTickPosition(QSlider::TicksBelow);
     QLabel *resolutionHint = new QLabel(this);
@@ -155,6 +176,25 @@ Launcher::Launcher()
     customResolutionLayout->addWidget(m_customWidth);
     customResolutionLayout->addWidget(new QLabel(tr(" x Height:"), this));
     customResolutionLayout->addWidget(m_customHeight);
+    QWidget *remoteApp = new QWidget(this);
+    m_remoteApp = new QLineEdit(this);
+    m_remoteApp->setPlaceholderText(tr("||alias or full path on the server"));
+    m_remoteAppArgs = new QLineEdit(this);
+    m_remoteAppDirectory = new QLineEdit(this);
+    QLabel *remoteAppLabel = new QLabel(tr("&Program:"), this);
+    remoteAppLabel->setBuddy(m_remoteApp);
+    QLabel *remoteAppArgsLabel = new QLabel(tr("Ar&guments:"), this);
+    remoteAppArgsLabel->setBuddy(m_remoteAppArgs);
+    QLabel *remoteAppDirectoryLabel = new QLabel(tr("&Working Directory:"), this);
+    remoteAppDirectoryLabel->setBuddy(m_remoteAppDirectory);
+    QGridLayout *remoteAppGrid = new QGridLayout(remoteApp);
+    remoteAppGrid->setContentsMargins(0, 0, 0, 0);
+    remoteAppGrid->addWidget(remoteAppLabel, 0, 0);
+    remoteAppGrid->addWidget(m_remoteApp, 0, 1);
+    remoteAppGrid->addWidget(remoteAppArgsLabel, 1, 0);
+    remoteAppGrid->addWidget(m_remoteAppArgs, 1, 1);
+    remoteAppGrid->addWidget(remoteAppDirectoryLabel, 2, 0);
+    remoteAppGrid->addWidget(m_remoteAppDirectory, 2, 1);
     QLabel *depthLabel = new QLabel(tr("&Color Depth:"), this);
     m_depth = new QComboBox(this);
     m_depth->addItems(QStringList { tr("High Color (15 bpp)"),
@@ -169,31 +209,45 @@ Launcher::Launcher()
     displayGrid->addWidget(m_resolution, 1, 1);
     displayGrid->addWidget(resolutionHint, 2, 1, 1, 1, Qt::AlignCenter);
     displayGrid->addWidget(customResolution, 3, 1);
-    displayGrid->addWidget(depthLabel, 4, 0);
-    displayGrid->addWidget(m_depth, 4, 1);
+    displayGrid->addWidget(remoteApp, 4, 1);
+    displayGrid->addWidget(depthLabel, 5, 0);
+    displayGrid->addWidget(m_depth, 5, 1);
+    m_memoryHint = new QLabel(this);
+    m_memoryHint->setWordWrap(true);
+    displayGrid->addWidget(m_memoryHint, 6, 0, 1, 2);
 
     connect(m_resolutionType, QOverload<int>::of(&QComboBox::currentIndexChanged),
-            [this, customResolution, resolutionHint](int type)
+            [this, customResolution, resolutionHint, remoteApp](int type)
     {
         switch (static_cast<ResolutionType>(type)) {
         case RT_Standard:
             m_resolution->setVisible(true);
             resolutionHint->setVisible(true);
             customResolution->setVisible(false);
+            remoteApp->setVisible(false);
             break;
         case RT_Custom:
             m_resolution->setVisible(false);
             resolutionHint->setVisible(false);
             customResolution->setVisible(true);
+            remoteApp->setVisible(false);
             break;
         case RT_Fullscreen:
             m_resolution->setVisible(false);
             resolutionHint->setVisible(false);
             customResolution->setVisible(false);
+            remoteApp->setVisible(false);
+            break;
+        case RT_RemoteApp:
+            m_resolution->setVisible(false);
+            resolutionHint->setVisible(false);
+            customResolution->setVisible(false);
+            remoteApp->setVisible(true);
             break;
         }
     });
     customResolution->setVisible(false);
+    remoteApp->setVisible(false);
 
     m_availableResolutions = getUsableResolutions();
     m_resolution->setMaximum(m_availableResolutions.size() - 1);
@@ -243,7 +297,7 @@ Launcher::Launcher()
     displayLayout->addWidget(displayGroup);
     displayLayout->addWidget(compressionGroup);
     displayLayout->addItem(new QSpacerItem(0, 0, QSizePolicy::Minimum, QSizePolicy::Expanding));
-    tabs->addTab(displayTab, tr("&Display"));
+    m_tabs->addTab(displayTab, tr("&Display"));
 
     QWidget *deviceTab = new QWidget(this);
     QGroupBox *audioGroup = new QGroupBox(tr("Audio"), this);
@@ -275,7 +329,7 @@ Launcher::Launcher()
     deviceLayout->addWidget(audioGroup);
     deviceLayout->addWidget(shareGroup);
     deviceLayout->addItem(new QSpacerItem(0, 0, QSizePolicy::Minimum, QSizePolicy::Expanding));
-    tabs->addTab(deviceTab, tr("De&vices"));
+    m_tabs->addTab(deviceTab, tr("De&vices"));
 
     QWidget *experienceTab = new QWidget(this);
     QGroupBox *performanceGroup = new QGroupBox(tr("Performance"), this);
@@ -319,11 +373,28 @@ Launcher::Launcher()
     cacheGrid->addWidget(m_offscreenCache, 1, 1);
     cacheGrid->addWidget(m_glyphCache, 2, 1);
 
+    QGroupBox *learnedGroup = new QGroupBox(tr("Learned settings"), this);
+    m_learnedHint = new QLabel(this);
+    m_learnedHint->setWordWrap(true);
+    m_applyLearned = new QPushButton(tr("Appl&y"), this);
+    m_autoApplyLearned = new QCheckBox(tr("Apply &automatically for each server"), this);
+    QGridLayout *learnedGrid = new QGridLayout(learnedGroup);
+    learnedGrid->addWidget(m_learnedHint, 0, 0);
+    learnedGrid->addWidget(m_applyLearned, 0, 1);
+    learnedGrid->addWidget(m_autoApplyLearned, 1, 0, 1, 2);
+
+    connect(m_applyLearned, &QPushButton::clicked, [this](bool)
+    {
+        applySettingsKey(m_learnedKey);
+        m_applyLearned->setEnabled(false);
+    });
+
     QVBoxLayout *experienceLayout = new QVBoxLayout(experienceTab);
     experienceLayout->addWidget(performanceGroup);
     experienceLayout->addWidget(cacheGroup);
+    experienceLayout->addWidget(learnedGroup);
     experienceLayout->addItem(new QSpacerItem(0, 0, QSizePolicy::Minimum, QSizePolicy::Expanding));
-    tabs->addTab(experienceTab, tr("E&xperience"));
+    m_tabs->addTab(experienceTab, tr("E&xperience"));
 
     QWidget *advancedTab = new QWidget(this);
     QGroupBox *gatewayGroup = new QGroupBox(tr("Gateway settings"), this);
@@ -348,6 +419,53 @@ Launcher::Launcher()
     gatewayGrid->addWidget(gatePasswordLabel, 3, 0);
     gatewayGrid->addWidget(m_gatePassword, 3, 1);
 
+    QGroupBox *sshGroup = new QGroupBox(tr("SSH tunnel"), this);
+    QLabel *sshHelp = new QLabel(tr("Reach this server through an SSH jump host.  Use "
+                                    "[user@]host or a Host from your ssh config.  ssh "
+                                    "can't prompt for anything here, so log in with a key "
+                                    "or agent, and accept the host key beforehand.  Leave "
+                                    "blank to connect directly."), this);
+    sshHelp->setWordWrap(true);
+    QLabel *sshJumpHostLabel = new QLabel(tr("&Jump Host:"), this);
+    m_sshJumpHost = new QLineEdit(this);
+    sshJumpHostLabel->setBuddy(m_sshJumpHost);
+    QGridLayout *sshGrid = new QGridLayout(sshGroup);
+    sshGrid->addWidget(sshHelp, 0, 0, 1, 2);
+    sshGrid->addWidget(sshJumpHostLabel, 1, 0);
+    sshGrid->addWidget(m_sshJumpHost, 1, 1);
+
+    QGroupBox *certGroup = new QGroupBox(tr("Server certificate"), this);
+    QLabel *certPolicyLabel = new QLabel(tr("&Trust:"), this);
+    m_certPolicy = new QComboBox(this);
+    m_certPolicy->addItems(QStringList { tr("Ask when connecting"),
+                                         tr("Trust on first use"),
+                                         tr("Pinned fingerprint"),
+                                         tr("Validate against system CAs") });
+    certPolicyLabel->setBuddy(m_certPolicy);
+    QLabel *certFingerprintLabel = new QLabel(tr("SHA-256 &Fingerprint:"), this);
+    m_certFingerprint = new QLineEdit(this);
+    certFingerprintLabel->setBuddy(m_certFingerprint);
+    m_certStatus = new QLabel(this);
+    m_certStatus->setWordWrap(true);
+    QGridLayout *certGrid = new QGridLayout(certGroup);
+    certGrid->addWidget(certPolicyLabel, 0, 0);
+    certGrid->addWidget(m_certPolicy, 0, 1);
+    certGrid->addWidget(certFingerprintLabel, 1, 0);
+    certGrid->addWidget(m_certFingerprint, 1, 1);
+    certGrid->addWidget(m_certStatus, 2, 0, 1, 2);
+
+    QGroupBox *clientGroup = new QGroupBox(tr("Client"), this);
+    QLabel *clientLabel = new QLabel(tr("FreeRDP c&lient:"), this);
+    m_client = new QComboBox(this);
+    m_client->addItems(availableClients());
+    if (m_client->findText(client.program) < 0)
+        m_client->addItem(client.program);
+    m_client->setCurrentText(client.program);
+    clientLabel->setBuddy(m_client);
+    QGridLayout *clientGrid = new QGridLayout(clientGroup);
+    clientGrid->addWidget(clientLabel, 0, 0);
+    clientGrid->addWidget(m_client, 0, 1);
+
     QGroupBox *extraParamsGroup = new QGroupBox(tr("Extra Parameters"), this);
     QLabel *extraParamsHint = new QLabel(tr("For options not yet available in the GUI, "
                                             "you may pass additional parameters here to be "
@@ -361,15 +479,134 @@ Launcher::Launcher()
     extraParamsGrid->addWidget(extraParamsLabel, 1, 0);
     extraParamsGrid->addWidget(m_extraParams, 1, 1);
 
+    QGroupBox *troubleshootingGroup = new QGroupBox(tr("Troubleshooting"), this);
+    m_captureLogs = new QCheckBox(tr("Capture xfreerdp &output"), this);
+    QLabel *captureLogsHint = new QLabel(tr("Recent output is kept in memory and only "
+                                            "written to disk if the session ends with "
+                                            "an error.  The launcher keeps running until "
+                                            "the session ends, which also lets it learn "
+                                            "from the session's history, as a resident "
+                                            "instance always does.  Run "
+                                            "\"qfreerdp --dump-logs\" for a resident "
+                                            "instance, or send the launcher SIGUSR1, to "
+                                            "write it out at any time."), this);
+    captureLogsHint->setWordWrap(true);
+    QGridLayout *troubleshootingGrid = new QGridLayout(troubleshootingGroup);
+    troubleshootingGrid->addWidget(m_captureLogs, 0, 0);
+    troubleshootingGrid->addWidget(captureLogsHint, 1, 0);
+
+    QGroupBox *memoryGroup = new QGroupBox(tr("Memory"), this);
+    QLabel *memoryHelp = new QLabel(tr("Check each session's estimated client memory "
+                                       "against what is left of this budget after the "
+                                       "FreeRDP clients already running on this host."), this);
+    memoryHelp->setWordWrap(true);
+    QLabel *memoryBudgetLabel = new QLabel(tr("Memory &budget:"), this);
+    m_memoryBudget = new QSpinBox(this);
+    m_memoryBudget->setRange(0, 1024 * 1024);
+    m_memoryBudget->setSingleStep(256);
+    m_memoryBudget->setSuffix(tr(" MiB"));
+    m_memoryBudget->setSpecialValueText(tr("Available memory"));
+    memoryBudgetLabel->setBuddy(m_memoryBudget);
+    QLabel *memoryPolicyLabel = new QLabel(tr("If it won't &fit:"), this);
+    m_memoryPolicy = new QComboBox(this);
+    m_memoryPolicy->addItems(QStringList { tr("Warn before connecting"),
+                                           tr("Lower settings to fit") });
+    memoryPolicyLabel->setBuddy(m_memoryPolicy);
+    QGridLayout *memoryGrid = new QGridLayout(memoryGroup);
+    memoryGrid->addWidget(memoryHelp, 0, 0, 1, 2);
+    memoryGrid->addWidget(memoryBudgetLabel, 1, 0);
+    memoryGrid->addWidget(m_memoryBudget, 1, 1);
+    memoryGrid->addWidget(memoryPolicyLabel, 2, 0);
+    memoryGrid->addWidget(m_memoryPolicy, 2, 1);
+
     QVBoxLayout *advancedLayout = new QVBoxLayout(advancedTab);
     advancedLayout->addWidget(gatewayGroup);
+    advancedLayout->addWidget(sshGroup);
+    advancedLayout->addWidget(certGroup);
+    advancedLayout->addWidget(clientGroup);
     advancedLayout->addWidget(extraParamsGroup);
+    advancedLayout->addWidget(memoryGroup);
+    advancedLayout->addWidget(troubleshootingGroup);
     advancedLayout->addItem(new QSpacerItem(0, 0, QSizePolicy::Minimum, QSizePolicy::Expanding));
-    tabs->addTab(advancedTab, tr("&Advanced"));
-
-    QPushButton *connectButton = new QPushButton(tr("&Connect"), this);
-    connectButton->setDefault(true);
-    connect(connectButton, &QPushButton::clicked, [this](bool)
+    m_tabs->addTab(advancedTab, tr("&Advanced"));
+
+    QWidget *testingTab = new QWidget(this);
+    QGroupBox *netEmuGroup = new QGroupBox(tr("Network emulation"), this);
+    m_netEmu = new QCheckBox(tr("Route through a local &emulated link"), this);
+    QLabel *netEmuHint = new QLabel(tr("Connections are relayed through the launcher with the "
+                                       "conditions below, to try out settings as if over a "
+                                       "slower network."), this);
+    netEmuHint->setWordWrap(true);
+    QLabel *netLatencyLabel = new QLabel(tr("&Latency (one way):"), this);
+    m_netLatency = new QSpinBox(this);
+    m_netLatency->setRange(0, 5000);
+    m_netLatency->setSuffix(tr(" ms"));
+    netLatencyLabel->setBuddy(m_netLatency);
+    QLabel *netJitterLabel = new QLabel(tr("&Jitter:"), this);
+    m_netJitter = new QSpinBox(this);
+    m_netJitter->setRange(0, 1000);
+    m_netJitter->setSuffix(tr(" ms"));
+    netJitterLabel->setBuddy(m_netJitter);
+    QLabel *netBandwidthLabel = new QLabel(tr("&Bandwidth:"), this);
+    m_netBandwidth = new QSpinBox(this);
+    m_netBandwidth->setRange(0, 10000000);
+    m_netBandwidth->setSuffix(tr(" kbps"));
+    m_netBandwidth->setSpecialValueText(tr("Unlimited"));
+    netBandwidthLabel->setBuddy(m_netBandwidth);
+    QLabel *netLossLabel = new QLabel(tr("Packet l&oss:"), this);
+    m_netLoss = new QDoubleSpinBox(this);
+    m_netLoss->setRange(0, 50);
+    m_netLoss->setSingleStep(0.5);
+    m_netLoss->setSuffix(tr(" %"));
+    netLossLabel->setBuddy(m_netLoss);
+    QLabel *netStallLabel = new QLabel(tr("&Stall every:"), this);
+    m_netStallInterval = new QSpinBox(this);
+    m_netStallInterval->setRange(0, 3600);
+    m_netStallInterval->setSuffix(tr(" s"));
+    m_netStallInterval->setSpecialValueText(tr("Never"));
+    netStallLabel->setBuddy(m_netStallInterval);
+    m_netStallLength = new QSpinBox(this);
+    m_netStallLength->setRange(0, 60000);
+    m_netStallLength->setPrefix(tr("for "));
+    m_netStallLength->setSuffix(tr(" ms"));
+    QGridLayout *netEmuGrid = new QGridLayout(netEmuGroup);
+    netEmuGrid->addWidget(m_netEmu, 0, 0, 1, 3);
+    netEmuGrid->addWidget(netEmuHint, 1, 0, 1, 3);
+    netEmuGrid->addWidget(netLatencyLabel, 2, 0);
+    netEmuGrid->addWidget(m_netLatency, 2, 1);
+    netEmuGrid->addWidget(netJitterLabel, 3, 0);
+    netEmuGrid->addWidget(m_netJitter, 3, 1);
+    netEmuGrid->addWidget(netBandwidthLabel, 4, 0);
+    netEmuGrid->addWidget(m_netBandwidth, 4, 1);
+    netEmuGrid->addWidget(netLossLabel, 5, 0);
+    netEmuGrid->addWidget(m_netLoss, 5, 1);
+    netEmuGrid->addWidget(netStallLabel, 6, 0);
+    netEmuGrid->addWidget(m_netStallInterval, 6, 1);
+    netEmuGrid->addWidget(m_netStallLength, 6, 2);
+
+    QGroupBox *recordGroup = new QGroupBox(tr("Session capture"), this);
+    m_recordTraffic = new QCheckBox(tr("&Record session traffic for replay"), this);
+    QLabel *recordHint = new QLabel(tr("Recording makes the session use the RemoteFX "
+                                       "codec only, which may be slower or look different, "
+                                       "and only RemoteFX data is recorded.  Recordings can "
+                                       "be played back without a server to compare bit "
+                                       "depths or clients, with "
+                                       "<tt>qfreerdp --replay-bench &lt;file&gt;</tt>.  "
+                                       "They may contain sensitive screen contents."), this);
+    recordHint->setWordWrap(true);
+    QVBoxLayout *recordLayout = new QVBoxLayout(recordGroup);
+    recordLayout->addWidget(m_recordTraffic);
+    recordLayout->addWidget(recordHint);
+
+    QVBoxLayout *testingLayout = new QVBoxLayout(testingTab);
+    testingLayout->addWidget(netEmuGroup);
+    testingLayout->addWidget(recordGroup);
+    testingLayout->addItem(new QSpacerItem(0, 0, QSizePolicy::Minimum, QSizePolicy::Expanding));
+    m_tabs->addTab(testingTab, tr("&Testing"));
+
+    m_connectButton = new QPushButton(tr("&Connect"), this);
+    m_connectButton->setDefault(true);
+    connect(m_connectButton, &QPushButton::clicked, [this](bool)
     {
         startXFreeRDP();
     });
@@ -381,16 +618,65 @@ Launcher::Launcher()
     QHBoxLayout *buttonLayout = new QHBoxLayout(buttonBox);
     buttonLayout->setContentsMargins(0, 0, 0, 0);
     buttonLayout->addItem(new QSpacerItem(0, 0, QSizePolicy::Expanding, QSizePolicy::Minimum));
-    buttonLayout->addWidget(connectButton);
+    buttonLayout->addWidget(m_connectButton);
     buttonLayout->addWidget(closeButton);
 
     QVBoxLayout *layout = new QVBoxLayout(this);
-    layout->addWidget(tabs);
+    layout->addWidget(m_tabs);
     layout->addWidget(buttonBox);
+
+    if (!m_profiles)
+        m_profiles = new ProfileStore(this);
+    connect(m_profiles, &ProfileStore::profilesChanged, this, &Launcher::profilesChanged);
+
+    // Only switch settings once a server has been picked or typed in full,
+    // not on every keystroke in the server box
+    connect(m_server, QOverload<int>::of(&QComboBox::activated), [this](int index)
+    {
+        serverChanged(m_server->itemText(index));
+    });
+    connect(m_server->lineEdit(), &QLineEdit::editingFinished, [this]()
+    {
+        serverChanged(m_server->currentText());
+    });
+
+    connect(m_resolutionType, SIGNAL(currentIndexChanged(int)), this, SLOT(updateMemoryEstimate()));
+    connect(m_resolution, SIGNAL(valueChanged(int)), this, SLOT(updateMemoryEstimate()));
+    connect(m_customWidth, SIGNAL(textChanged(QString)), this, SLOT(updateMemoryEstimate()));
+    connect(m_customHeight, SIGNAL(textChanged(QString)), this, SLOT(updateMemoryEstimate()));
+    connect(m_depth, SIGNAL(currentIndexChanged(int)), this, SLOT(updateMemoryEstimate()));
+    connect(m_memoryBudget, SIGNAL(valueChanged(int)), this, SLOT(updateMemoryEstimate()));
+    for (QCheckBox *cb : { m_jpeg, m_bitmapCache, m_offscreenCache, m_glyphCache })
+        connect(cb, SIGNAL(toggled(bool)), this, SLOT(updateMemoryEstimate()));
+
+    // Scanning /proc for running clients is too slow to do on every
+    // keystroke, so the estimate works from a total refreshed now and then
+    m_memoryRefresh = new QTimer(this);
+    m_memoryRefresh->setInterval(5000);
+    connect(m_memoryRefresh, SIGNAL(timeout()), this, SLOT(refreshRunningMemory()));
+    m_memoryRefresh->start();
+
+    // Fetch the certificate once the server name settles, so it's ready
+    // by the time the user has typed their password
+    m_certFetcher = new CertificateFetcher(this);
+    m_certPrefetch = new QTimer(this);
+    m_certPrefetch->setSingleShot(true);
+    m_certPrefetch->setInterval(500);
+    connect(m_certPrefetch, &QTimer::timeout, this, &Launcher::prefetchCertificate);
+    connect(m_certFetcher, &CertificateFetcher::finished,
+            this, &Launcher::updateCertificateStatus);
+    connect(m_certFetcher, &CertificateFetcher::finished,
+            this, &Launcher::certificateFetched);
+    connect(m_server, SIGNAL(currentTextChanged(QString)), m_certPrefetch, SLOT(start()));
+    connect(m_sshJumpHost, SIGNAL(textChanged(QString)), m_certPrefetch, SLOT(start()));
+    connect(m_certPolicy, SIGNAL(currentIndexChanged(int)), m_certPrefetch, SLOT(start()));
+    connect(m_certFingerprint, SIGNAL(textChanged(QString)),
+            this, SLOT(updateCertificateStatus()));
 }
 
 void Launcher::saveConfig()
 {
+    TRACE_SCOPE("Launcher::saveConfig");
     QSettings settings(QStringLiteral("qfreerdp"), QStringLiteral("qfreerdp"));
 
     // General
@@ -405,273 +691,429 @@ void Launcher::saveConfig()
     settings.setValue(QStringLiteral("AllServers"), allServers);
     settings.setValue(QStringLiteral("Username"), m_username->text());
 
-    // Display
-    settings.setValue(QStringLiteral("ResolutionType"), m_resolutionType->currentIndex());
-    settings.setValue(QStringLiteral("StandardResolution"),
-                      m_availableResolutions[m_resolution->value()]);
-    settings.setValue(QStringLiteral("CustomResolution"),
-                      QSize(m_customWidth->text().toInt(), m_customHeight->text().toInt()));
-    settings.setValue(QStringLiteral("BitDepth"), s_depths[m_depth->currentIndex()]);
-
-    settings.setValue(QStringLiteral("CompressionType"), m_compression->currentIndex());
-    settings.setValue(QStringLiteral("Jpeg"), m_jpeg->isChecked());
-    settings.setValue(QStringLiteral("JpegLevel"), m_jpegLevel->value());
-
-    // Devices
-    settings.setValue(QStringLiteral("AudioMode"), m_audioMode->currentIndex());
-    settings.setValue(QStringLiteral("Clipboard"), m_clipboard->isChecked());
-    settings.setValue(QStringLiteral("RedirectDrives"), m_redirectDrives->isChecked());
-    settings.setValue(QStringLiteral("RedirectHome"), m_redirectHome->isChecked());
-
-    // Experience
-    settings.setValue(QStringLiteral("Wallpaper"), m_wallpaper->isChecked());
-    settings.setValue(QStringLiteral("FontSmoothing"), m_fontSmoothing->isChecked());
-    settings.setValue(QStringLiteral("Aero"), m_aero->isChecked());
-    settings.setValue(QStringLiteral("WindowDrag"), m_windowDrag->isChecked());
-    settings.setValue(QStringLiteral("MenuAnims"), m_menuAnims->isChecked());
-    settings.setValue(QStringLiteral("Themes"), m_themes->isChecked());
+    // The dialog shows the shared profile's values for the keys it defines,
+    // and saving those would replace the user's own settings with them
+    const QVariantMap &profile = m_appliedProfile;
+    auto setValue = [&settings, &profile](const QString &key, const QVariant &value)
+    {
+        if (!profile.contains(key))
+            settings.setValue(key, value);
+    };
 
-    settings.setValue(QStringLiteral("BitmapCache"), m_bitmapCache->isChecked());
-    settings.setValue(QStringLiteral("OffscreenCache"), m_offscreenCache->isChecked());
-    settings.setValue(QStringLiteral("GlyphCache"), m_glyphCache->isChecked());
+    writeConnectionSettings(setValue, connectionSettings());
+    setValue(QStringLiteral("AutoApplyLearned"), m_autoApplyLearned->isChecked());
 
     // Advanced
-    settings.setValue(QStringLiteral("Gateway"), m_gateServer->text());
-    settings.setValue(QStringLiteral("GatewayUsername"), m_gateUsername->text());
-    settings.setValue(QStringLiteral("ExtraParams"), m_extraParams->text());
+    const QString server = m_server->currentText();
+    if (!profile.contains(QStringLiteral("SshJumpHost"))) {
+        if (m_sshJumpHost->text().isEmpty())
+            m_sshJumpHosts.remove(server);
+        else
+            m_sshJumpHosts.insert(server, m_sshJumpHost->text());
+        settings.setValue(QStringLiteral("SshJumpHosts"), m_sshJumpHosts);
+    }
+    if (!profile.contains(QStringLiteral("CertPolicy"))) {
+        if (m_certPolicy->currentIndex() == CP_Ask)
+            m_certPolicies.remove(server);
+        else
+            m_certPolicies.insert(server, m_certPolicy->currentIndex());
+        settings.setValue(QStringLiteral("CertPolicies"), m_certPolicies);
+    }
+    if (!profile.contains(QStringLiteral("CertFingerprint"))) {
+        if (m_certFingerprint->text().isEmpty())
+            m_certFingerprints.remove(server);
+        else
+            m_certFingerprints.insert(server, m_certFingerprint->text());
+        settings.setValue(QStringLiteral("CertFingerprints"), m_certFingerprints);
+    }
+    settings.setValue(QStringLiteral("CertWaits"), m_certWaits);
+    if (m_client->currentText() != m_defaultClient)
+        settings.setValue(QStringLiteral("Client"), m_client->currentText());
+    setValue(QStringLiteral("CaptureLogs"), m_captureLogs->isChecked());
+    setValue(QStringLiteral("MemoryBudget"), m_memoryBudget->value());
+    setValue(QStringLiteral("MemoryPolicy"), m_memoryPolicy->currentIndex());
+
+    // Testing
+    setValue(QStringLiteral("NetEmu"), m_netEmu->isChecked());
+    setValue(QStringLiteral("NetEmuLatency"), m_netLatency->value());
+    setValue(QStringLiteral("NetEmuJitter"), m_netJitter->value());
+    setValue(QStringLiteral("NetEmuBandwidth"), m_netBandwidth->value());
+    setValue(QStringLiteral("NetEmuLoss"), m_netLoss->value());
+    setValue(QStringLiteral("NetEmuStallInterval"), m_netStallInterval->value());
+    setValue(QStringLiteral("NetEmuStallLength"), m_netStallLength->value());
+    setValue(QStringLiteral("RecordTraffic"), m_recordTraffic->isChecked());
 }
 
 void Launcher::restoreConfig()
 {
+    TRACE_SCOPE("Launcher::restoreConfig");
     QSettings settings(QStringLiteral("qfreerdp"), QStringLiteral("qfreerdp"));
 
     // General
-    m_server->addItems(settings.value(QStringLiteral("AllServers"), QStringList{}).toStringList());
-    m_server->setCurrentText(settings.value(QStringLiteral("CurrentServer")).toString());
+    {
+        // Settings are loaded once below, not for every server we add
+        QSignalBlocker blocker(m_server);
+        m_server->addItems(settings.value(QStringLiteral("AllServers"), QStringList{}).toStringList());
+        for (const QString &server : m_profiles->servers()) {
+            if (m_server->findText(server) < 0)
+                m_server->addItem(server);
+        }
+        m_server->setCurrentText(settings.value(QStringLiteral("CurrentServer")).toString());
+    }
     m_username->setText(settings.value(QStringLiteral("Username")).toString());
+    m_sshJumpHosts = settings.value(QStringLiteral("SshJumpHosts")).toMap();
+    m_certPolicies = settings.value(QStringLiteral("CertPolicies")).toMap();
+    m_certFingerprints = settings.value(QStringLiteral("CertFingerprints")).toMap();
+    m_certWaits = settings.value(QStringLiteral("CertWaits")).toMap();
+
+    loadSettings(m_profiles->profile(m_server->currentText()));
+
+    {
+        TRACE_SCOPE("sessionHistory");
+        m_history = sessionHistory();
+    }
+    updateRecommendation();
+    refreshRunningMemory();
+    prefetchCertificate();
+}
+
+void Launcher::connectWithPassword(const QString &password)
+{
+    m_password->setText(password);
+    QTimer::singleShot(0, this, SLOT(startXFreeRDP()));
+}
+
+void Launcher::loadSettings(const QVariantMap &profile)
+{
+    TRACE_SCOPE("Launcher::loadSettings");
+    // Values from a shared profile take precedence over the user's own
+    QSettings settings(QStringLiteral("qfreerdp"), QStringLiteral("qfreerdp"));
+    auto value = [&settings, &profile](const QString &key, const QVariant &defaultValue)
+    {
+        auto iter = profile.constFind(key);
+        return (iter != profile.constEnd()) ? *iter : settings.value(key, defaultValue);
+    };
+    m_appliedProfile = profile;
+    m_loadedServer = m_server->currentText();
+
+    applyConnectionSettings(readConnectionSettings(value));
+    m_autoApplyLearned->setChecked(value(QStringLiteral("AutoApplyLearned"),
+                                         QStringLiteral("false")).toBool());
+
+    // Advanced
+    m_sshJumpHost->setText(value(QStringLiteral("SshJumpHost"),
+                                 m_sshJumpHosts.value(m_server->currentText())).toString());
+    m_certPolicy->setCurrentIndex(value(QStringLiteral("CertPolicy"),
+                                        m_certPolicies.value(m_server->currentText(),
+                                                             CP_Ask)).toInt());
+    m_certFingerprint->setText(value(QStringLiteral("CertFingerprint"),
+                                     m_certFingerprints.value(m_server->currentText()))
+                               .toString());
+    m_captureLogs->setChecked(value(QStringLiteral("CaptureLogs"),
+                                    QStringLiteral("false")).toBool());
+    m_memoryBudget->setValue(value(QStringLiteral("MemoryBudget"),
+                                   QStringLiteral("0")).toInt());
+    m_memoryPolicy->setCurrentIndex(value(QStringLiteral("MemoryPolicy"),
+                                          QStringLiteral("0")).toInt());
+
+    // Testing
+    m_netEmu->setChecked(value(QStringLiteral("NetEmu"),
+                               QStringLiteral("false")).toBool());
+    m_netLatency->setValue(value(QStringLiteral("NetEmuLatency"),
+                                 QStringLiteral("150")).toInt());
+    m_netJitter->setValue(value(QStringLiteral("NetEmuJitter"),
+                                QStringLiteral("0")).toInt());
+    m_netBandwidth->setValue(value(QStringLiteral("NetEmuBandwidth"),
+                                   QStringLiteral("2000")).toInt());
+    m_netLoss->setValue(value(QStringLiteral("NetEmuLoss"),
+                              QStringLiteral("0")).toDouble());
+    m_netStallInterval->setValue(value(QStringLiteral("NetEmuStallInterval"),
+                                       QStringLiteral("0")).toInt());
+    m_netStallLength->setValue(value(QStringLiteral("NetEmuStallLength"),
+                                     QStringLiteral("500")).toInt());
+    m_recordTraffic->setChecked(value(QStringLiteral("RecordTraffic"),
+                                      QStringLiteral("false")).toBool());
+}
+
+ConnectionSettings Launcher::connectionSettings() const
+{
+    ConnectionSettings connection;
+    connection.server = m_server->currentText();
+    connection.username = m_username->text();
+    connection.password = m_password->text();
 
     // Display
-    m_resolutionType->setCurrentIndex(settings.value(QStringLiteral("ResolutionType"),
-                                                     QStringLiteral("0")).toInt());
-    QSize stdResolution = settings.value(QStringLiteral("StandardResolution"),
-                                         m_availableResolutions.last()).toSize();
+    connection.resolutionType = m_resolutionType->currentIndex();
+    connection.standardSize = m_availableResolutions[m_resolution->value()];
+    connection.customSize = QSize(m_customWidth->text().toInt(), m_customHeight->text().toInt());
+    connection.remoteApp = m_remoteApp->text();
+    connection.remoteAppArgs = m_remoteAppArgs->text();
+    connection.remoteAppDirectory = m_remoteAppDirectory->text();
+    connection.bpp = s_depths[m_depth->currentIndex()];
+
+    connection.compression = m_compression->currentIndex();
+    connection.jpeg = m_jpeg->isChecked();
+    connection.jpegQuality = m_jpegLevel->value();
+
+    // Devices
+    connection.audioMode = m_audioMode->currentIndex();
+    connection.clipboard = m_clipboard->isChecked();
+    connection.redirectDrives = m_redirectDrives->isChecked();
+    connection.redirectHome = m_redirectHome->isChecked();
+
+    // Experience
+    connection.wallpaper = m_wallpaper->isChecked();
+    connection.fontSmoothing = m_fontSmoothing->isChecked();
+    connection.aero = m_aero->isChecked();
+    connection.windowDrag = m_windowDrag->isChecked();
+    connection.menuAnims = m_menuAnims->isChecked();
+    connection.themes = m_themes->isChecked();
+
+    connection.bitmapCache = m_bitmapCache->isChecked();
+    connection.offscreenCache = m_offscreenCache->isChecked();
+    connection.glyphCache = m_glyphCache->isChecked();
+
+    // Advanced
+    connection.gateway = m_gateServer->text();
+    connection.gatewayUsername = m_gateUsername->text();
+    connection.gatewayPassword = m_gatePassword->text();
+    connection.extraParams = m_extraParams->text();
+    return connection;
+}
+
+void Launcher::applyConnectionSettings(const ConnectionSettings &connection)
+{
+    // Display
+    m_resolutionType->setCurrentIndex(connection.resolutionType);
     int stdResolutionIndex = m_availableResolutions.size() - 1;
     for (int i = 0; i < m_availableResolutions.size(); ++i) {
-        if (m_availableResolutions[i] == stdResolution) {
+        if (m_availableResolutions[i] == connection.standardSize) {
             stdResolutionIndex = i;
             break;
         }
     }
     m_resolution->setValue(stdResolutionIndex);
-    QSize customResolution = settings.value(QStringLiteral("CustomResolution"),
-                                            QSize(0, 0)).toSize();
-    m_customWidth->setText(QString::number(customResolution.width()));
-    m_customHeight->setText(QString::number(customResolution.height()));
-    int bitDepth = settings.value(QStringLiteral("BitDepth"),
-                                  QString::number(s_depths.last())).toInt();
-    int bitDepthIndex = s_depths.size() - 1;
-    for (int i = 0; i < s_depths.size(); ++i) {
-        if (s_depths[i] == bitDepth) {
-            bitDepthIndex = i;
-            break;
-        }
-    }
-    m_depth->setCurrentIndex(bitDepthIndex);
-
-    m_compression->setCurrentIndex(settings.value(QStringLiteral("Compression"),
-                                                  QStringLiteral("1")).toInt());
-    m_jpeg->setChecked(settings.value(QStringLiteral("Jpeg"),
-                                      QStringLiteral("false")).toBool());
-    m_jpegLevel->setValue(settings.value(QStringLiteral("JpegLevel"),
-                                         QStringLiteral("95")).toInt());
+    m_customWidth->setText(QString::number(connection.customSize.width()));
+    m_customHeight->setText(QString::number(connection.customSize.height()));
+    m_remoteApp->setText(connection.remoteApp);
+    m_remoteAppArgs->setText(connection.remoteAppArgs);
+    m_remoteAppDirectory->setText(connection.remoteAppDirectory);
+    int bitDepthIndex = s_depths.indexOf(connection.bpp);
+    m_depth->setCurrentIndex(bitDepthIndex < 0 ? s_depths.size() - 1 : bitDepthIndex);
+
+    m_compression->setCurrentIndex(connection.compression);
+    m_jpeg->setChecked(connection.jpeg);
+    m_jpegLevel->setValue(connection.jpegQuality);
 
     // Devices
-    m_audioMode->setCurrentIndex(settings.value(QStringLiteral("AudioMode"),
-                                                QStringLiteral("0")).toInt());
-    m_clipboard->setChecked(settings.value(QStringLiteral("Clipboard"),
-                                           QStringLiteral("true")).toBool());
-    m_redirectDrives->setChecked(settings.value(QStringLiteral("RedirectDrives"),
-                                                QStringLiteral("false")).toBool());
-    m_redirectHome->setChecked(settings.value(QStringLiteral("RedirectHome"),
-                                              QStringLiteral("false")).toBool());
+    m_audioMode->setCurrentIndex(connection.audioMode);
+    m_clipboard->setChecked(connection.clipboard);
+    m_redirectDrives->setChecked(connection.redirectDrives);
+    m_redirectHome->setChecked(connection.redirectHome);
 
     // Experience
-    m_wallpaper->setChecked(settings.value(QStringLiteral("Wallpaper"),
-                                           QStringLiteral("true")).toBool());
-    m_fontSmoothing->setChecked(settings.value(QStringLiteral("FontSmoothing"),
-                                               QStringLiteral("true")).toBool());
-    m_aero->setChecked(settings.value(QStringLiteral("Aero"),
-                                      QStringLiteral("true")).toBool());
-    m_windowDrag->setChecked(settings.value(QStringLiteral("WindowDrag"),
-                                            QStringLiteral("true")).toBool());
-    m_menuAnims->setChecked(settings.value(QStringLiteral("MenuAnims"),
-                                           QStringLiteral("true")).toBool());
-    m_themes->setChecked(settings.value(QStringLiteral("Themes"),
-                                        QStringLiteral("true")).toBool());
-
-    m_bitmapCache->setChecked(settings.value(QStringLiteral("BitmapCache"),
-                                             QStringLiteral("true")).toBool());
-    m_offscreenCache->setChecked(settings.value(QStringLiteral("OffscreenCache"),
-                                                QStringLiteral("true")).toBool());
-    m_glyphCache->setChecked(settings.value(QStringLiteral("GlyphCache"),
-                                            QStringLiteral("true")).toBool());
+    m_wallpaper->setChecked(connection.wallpaper);
+    m_fontSmoothing->setChecked(connection.fontSmoothing);
+    m_aero->setChecked(connection.aero);
+    m_windowDrag->setChecked(connection.windowDrag);
+    m_menuAnims->setChecked(connection.menuAnims);
+    m_themes->setChecked(connection.themes);
 
-    // Advanced
-    m_gateServer->setText(settings.value(QStringLiteral("Gateway")).toString());
-    m_gateUsername->setText(settings.value(QStringLiteral("GatewayUsername")).toString());
-    m_extraParams->setText(settings.value(QStringLiteral("ExtraParams")).toString());
-}
-
-static QString stripQuotes(QString text)
-{
-    if (text.at(0) == '"' && text.at(text.size() - 1) == '"')
-        text = text.mid(1, text.size() - 2);
-    else if (text.at(0) == '\'' && text.at(text.size() - 1) == '\'')
-        text = text.mid(1, text.size() - 2);
-    text.replace("\\\"", "\"").replace("\\'", "'");
-    return text;
-}
-
-static QStringList splitParams(const QString &text)
-{
-    QStringList result;
-    int start = 0;
-    int quotes = 0;
-    QChar last(0);
-    for (int cursor = 0; cursor < text.size(); ++cursor) {
-        QChar ch = text.data()[cursor];
-        if (quotes == 0 && ch == ' ') {
-            QString param = text.mid(start, cursor - start);
-            if (!param.isEmpty())
-                result.append(stripQuotes(param));
-            start = cursor + 1;
-        } else if (ch == '"') {
-            if (quotes == 2) {
-                if (last != '\\')
-                    quotes = 0;
-            } else if (quotes == 0) {
-                if (last != '\\')
-                    quotes = 2;
-            }
-        } else if (ch == '\'') {
-            if (quotes == 1) {
-                if (last != '\\')
-                    quotes = 0;
-            } else if (quotes == 0) {
-                if (last != '\\')
-                    quotes = 1;
-            }
-        }
-        last = ch;
-    }
-    QString remainder = text.mid(start);
-    if (!remainder.isEmpty())
-        result.append(stripQuotes(remainder));
+    m_bitmapCache->setChecked(connection.bitmapCache);
+    m_offscreenCache->setChecked(connection.offscreenCache);
+    m_glyphCache->setChecked(connection.glyphCache);
 
-    return result;
+    // Advanced
+    m_gateServer->setText(connection.gateway);
+    m_gateUsername->setText(connection.gatewayUsername);
+    m_extraParams->setText(connection.extraParams);
 }
 
 void Launcher::startXFreeRDP()
 {
-    QStringList params;
-    if (m_server->currentText().isEmpty()) {
-        QMessageBox::critical(this, tr("Missing server"), tr("Server name must not be empty."));
-        return;
-    }
-    params.append(QStringLiteral("/v:%1").arg(m_server->currentText()));
-    if (m_username->text().isEmpty()) {
-        QMessageBox::critical(this, tr("Missing username"), tr("Username must not be empty."));
+    TRACE_SCOPE("Launcher::startXFreeRDP");
+    if (m_session)
         return;
+
+    QString program = m_client->currentText();
+    ClientInfo client = m_clientInfo.value(program);
+    if (client.program.isEmpty()) {
+        if (!probeClient(program, &client)) {
+            QMessageBox::critical(this, tr("Error starting %1").arg(program),
+                                  tr("Could not start %1.  Is it in your PATH?").arg(program));
+            return;
+        }
+        if (client.major != 2 && client.major != 3) {
+            QMessageBox::critical(this, tr("Unsupported client"),
+                                  tr("%1 reported version %2, but we require FreeRDP 2.x or 3.x")
+                                  .arg(program, client.version));
+            return;
+        }
+        m_clientInfo.insert(program, client);
     }
-    params.append(QStringLiteral("/u:%1").arg(m_username->text()));
 
-    // xfreerdp will mask this out for us in the running process
-    if (m_password->text().isEmpty()) {
-        QMessageBox::critical(this, tr("Missing password"), tr("Password must not be empty."));
+    // Catch what the user can fix before anything slow happens
+    ConnectionSettings connection = connectionSettings();
+    QString error;
+    if (!validateSettings(connection, client.major, &error)) {
+        QMessageBox::critical(this, tr("Invalid settings"), error);
         return;
     }
-    params.append(QStringLiteral("/p:%1").arg(m_password->text()));
 
-    switch (static_cast<ResolutionType>(m_resolutionType->currentIndex())) {
-    case RT_Standard:
-        {
-            int stdSize = m_resolution->value();
-            QSize size = m_availableResolutions[stdSize];
-            params.append(QStringLiteral("/size:%1x%2").arg(size.width()).arg(size.height()));
-        }
-        break;
-    case RT_Custom:
-        for (QLineEdit *le : { m_customWidth, m_customHeight }) {
-            const QValidator *validator = le->validator();
-            QString text = le->text();
-            int cursor = le->cursorPosition();
-            if (validator->validate(text, cursor) != QValidator::Acceptable) {
-                QMessageBox::critical(this, tr("Invalid input"),
-                                      tr("Invalid custom resolution specified"));
-                return;
-            }
-        }
-        params.append(QStringLiteral("/size:%1x%2").arg(m_customWidth->text())
-                                                   .arg(m_customHeight->text()));
-        break;
-    case RT_Fullscreen:
-        params.append(QStringLiteral("/f"));
-        break;
+    // FreeRDP 2.x can only be told to skip verification, which would leave
+    // the real connection open to whoever answers
+    if (client.major < 3 && m_certPolicy->currentIndex() != CP_Ask) {
+        QMessageBox::critical(this, tr("Certificate policy"),
+                              tr("%1 is FreeRDP %2, which can't be told which certificate to "
+                                 "trust.\n\nSet the certificate policy to \"%3\" or use a "
+                                 "FreeRDP 3.x client.")
+                              .arg(program, client.version, m_certPolicy->itemText(CP_Ask)));
+        return;
     }
 
-    int bppSel = m_depth->currentIndex();
-    params.append(QStringLiteral("/bpp:%1").arg(s_depths[bppSel]));
-
-    int compression = m_compression->currentIndex();
-    if (compression == CT_Disabled)
-        params.append(QStringLiteral("-compression"));
-    else if (compression == CT_Default)
-        params.append(QStringLiteral("+compression"));
-    else
-        params.append(QStringLiteral("/compression-level:%1").arg(compression - CT_Level));
+    // Lowering settings to fit is only for this session, so the widgets
+    // keep what the user chose
+    if (!fitMemoryBudget(&connection))
+        return;
 
-    if (m_jpeg->isChecked()) {
-        params.append(QStringLiteral("/jpeg"));
-        params.append(QStringLiteral("/jpeg-quality:%1").arg(m_jpegLevel->value()));
+    // The dialog owns the session until the client is running, so closing
+    // it while we wait on ssh cancels everything
+    m_session = new Session(m_server->currentText(), m_captureLogs->isChecked(), this);
+    m_session->setSettingsKey(settingsKey(connection));
+    m_session->setSupervised(m_resident);
+    m_sessionClient = client;
+    m_sessionSettings = connection;
+
+    QString host;
+    quint16 port;
+    splitServer(m_server->currentText(), &host, &port);
+    if (m_sshJumpHost->text().isEmpty()) {
+        connectTo(host, port, QString());
+        return;
     }
 
-    params.append(QStringLiteral("/audio-mode:%1").arg(m_audioMode->currentIndex()));
-
-    params.append(QStringLiteral("%1clipboard").arg(m_clipboard->isChecked() ? "+" : "-"));
-    params.append(QStringLiteral("%1drives").arg(m_redirectDrives->isChecked() ? "+" : "-"));
-    params.append(QStringLiteral("%1home-drive").arg(m_redirectHome->isChecked() ? "+" : "-"));
+    m_tunnel = new SshTunnel(m_sshJumpHost->text(), host, port, m_session);
+    connect(m_tunnel, &SshTunnel::opened, this, &Launcher::tunnelOpened);
+    connect(m_tunnel, &SshTunnel::failed, this, &Launcher::tunnelFailed);
+    setConnecting(true);
+    m_tunnel->open();
+}
 
-    params.append(QStringLiteral("%1fonts").arg(m_fontSmoothing->isChecked() ? "+" : "-"));
-    params.append(QStringLiteral("%1aero").arg(m_aero->isChecked() ? "+" : "-"));
-    params.append(QStringLiteral("%1window-drag").arg(m_windowDrag->isChecked() ? "+" : "-"));
-    params.append(QStringLiteral("%1menu-anims").arg(m_menuAnims->isChecked() ? "+" : "-"));
-    params.append(QStringLiteral("%1themes").arg(m_themes->isChecked() ? "+" : "-"));
-    params.append(QStringLiteral("%1wallpaper").arg(m_wallpaper->isChecked() ? "+" : "-"));
+void Launcher::tunnelOpened()
+{
+    const QString host = QStringLiteral("127.0.0.1");
+    connectTo(host, m_tunnel->localPort(),
+              QStringLiteral("%1:%2").arg(host).arg(m_tunnel->localPort()));
+}
 
-    params.append(QStringLiteral("%1bitmap-cache").arg(m_bitmapCache->isChecked() ? "+" : "-"));
-    params.append(QStringLiteral("%1offscreen-cache").arg(m_offscreenCache->isChecked() ? "+" : "-"));
-    params.append(QStringLiteral("%1glyph-cache").arg(m_glyphCache->isChecked() ? "+" : "-"));
+void Launcher::tunnelFailed(const QString &error)
+{
+    abortConnect();
+    QMessageBox::critical(this, tr("SSH tunnel"),
+                          tr("Could not open a tunnel through %1:\n%2")
+                          .arg(m_sshJumpHost->text(), error));
+}
 
-    if (!m_gateServer->text().isEmpty())
-        params.append(QStringLiteral("/g:%1").arg(m_gateServer->text()));
-    if (!m_gateUsername->text().isEmpty()) {
-        params.append(QStringLiteral("/gu:%1").arg(m_gateUsername->text()));
-        params.append(QStringLiteral("/gp:%1").arg(m_gatePassword->text()));
+void Launcher::connectTo(const QString &host, quint16 port, const QString &tunnelTarget)
+{
+    m_verifiedFingerprint.clear();
+    if (m_certPolicy->currentIndex() == CP_Ask) {
+        startSession(host, port, tunnelTarget);
+        return;
     }
 
-    QStringList extraParams = splitParams(m_extraParams->text());
-    params.append(extraParams);
+    // Check the certificate where the client will connect, but before any
+    // emulated delays get in the way
+    QString realHost;
+    quint16 realPort;
+    splitServer(m_server->currentText(), &realHost, &realPort);
+
+    m_certPending = true;
+    m_pendingHost = host;
+    m_pendingPort = port;
+    m_pendingTarget = tunnelTarget;
+    m_certWaited.start();
+    m_certTraceBegin = g_traceEnabled ? traceClock() : 0;
+    setConnecting(true);
+
+    // Normally the prefetch has already finished, or is about to
+    if (m_certFetcher->host() != host || m_certFetcher->port() != port
+            || m_certFetcher->peerName() != realHost
+            || (!m_certFetcher->isRunning() && !m_certFetcher->result().fetched))
+        m_certFetcher->fetch(host, port, realHost);
+    else if (!m_certFetcher->isRunning())
+        certificateFetched();
+}
 
-    QProcess proc;
-    if (!proc.startDetached(QStringLiteral("xfreerdp"), params)) {
-        QMessageBox::critical(this, tr("Error starting xfreerdp"),
-                              tr("Could not start xfreerdp.  Is it in your PATH?"));
+void Launcher::startSession(const QString &host, quint16 port, const QString &tunnelTarget)
+{
+    QString target = tunnelTarget;
+
+    if (m_netEmu->isChecked()) {
+        LinkConditions conditions;
+        conditions.latencyMsecs = m_netLatency->value();
+        conditions.jitterMsecs = m_netJitter->value();
+        conditions.bandwidthKbps = m_netBandwidth->value();
+        conditions.lossPercent = m_netLoss->value();
+        conditions.stallInterval = m_netStallInterval->value();
+        conditions.stallMsecs = m_netStallLength->value();
+
+        NetworkRelay *relay = new NetworkRelay(host, port, conditions);
+        m_session->setRelay(relay);
+        if (!relay->listen()) {
+            abortConnect();
+            QMessageBox::critical(this, tr("Network emulation"),
+                                  tr("Could not start the local relay."));
+            return;
+        }
+        target = QStringLiteral("127.0.0.1:%1").arg(relay->localPort());
+    }
+
+    ConnectionSettings connection = m_sessionSettings;
+    connection.target = target;
+    connection.certFingerprint = m_verifiedFingerprint;
+    if (m_recordTraffic->isChecked())
+        connection.captureFile = captureFileName(connection.server);
+    QStringList params = clientParams(connection, m_sessionClient.major);
+
+    bool detached = m_session->isDetached();
+    if (!m_session->start(m_sessionClient.program, params)) {
+        abortConnect();
+        QMessageBox::critical(this, tr("Error starting %1").arg(m_sessionClient.program),
+                              tr("Could not start %1.  Is it in your PATH?")
+                              .arg(m_sessionClient.program));
         return;
     }
+    // From here on the session looks after itself
+    m_session->setParent(Q_NULLPTR);
+    m_session = Q_NULLPTR;
+    // Nobody will be around to cancel the forward for a detached client
+    if (m_tunnel && detached)
+        m_tunnel->detach();
+    m_tunnel = Q_NULLPTR;
+    setConnecting(false);
+
     saveConfig();
     close();
 }
 
+void Launcher::abortConnect()
+{
+    // We may be called from one of the tunnel's signals
+    m_session->deleteLater();
+    m_session = Q_NULLPTR;
+    m_tunnel = Q_NULLPTR;
+    m_certPending = false;
+    setConnecting(false);
+}
+
+void Launcher::setConnecting(bool connecting)
+{
+    m_tabs->setEnabled(!connecting);
+    m_connectButton->setEnabled(!connecting);
+    m_connectButton->setText(connecting ? tr("Connecting...") : tr("&Connect"));
+}
+
 void Launcher::perfPresetChanged(int index)
 {
     switch (static_cast<PerformancePreset>(index)) {
@@ -713,7 +1155,7 @@ void Launcher::perfPresetChanged(int index)
     }
 }
 
-void Launcher::perfItemChanged(bool)
+uint Launcher::perfSelector() const
 {
     uint selector = 0;
     if (m_wallpaper->isChecked())
@@ -728,27 +1170,358 @@ void Launcher::perfItemChanged(bool)
         selector |= (1<<4);
     if (m_themes->isChecked())
         selector |= (1<<5);
+    return selector;
+}
 
-    // Don't cycle between here and perfPresetChanged()
-    disconnect(m_performancePreset, SIGNAL(currentIndexChanged(int)),
-               this, SLOT(perfPresetChanged(int)));
+static Launcher::PerformancePreset presetForSelector(uint selector)
+{
     switch (selector) {
     case 0:
-        m_performancePreset->setCurrentIndex(PP_Minimum);
-        break;
+        return Launcher::PP_Minimum;
     case 0x20:
-        m_performancePreset->setCurrentIndex(PP_Low);
-        break;
+        return Launcher::PP_Low;
     case 0x24:
-        m_performancePreset->setCurrentIndex(PP_Mid);
-        break;
+        return Launcher::PP_Mid;
     case 0x3F:
-        m_performancePreset->setCurrentIndex(PP_High);
-        break;
+        return Launcher::PP_High;
     default:
-        m_performancePreset->setCurrentIndex(PP_Custom);
-        break;
+        return Launcher::PP_Custom;
     }
+}
+
+void Launcher::perfItemChanged(bool)
+{
+    // Don't cycle between here and perfPresetChanged()
+    disconnect(m_performancePreset, SIGNAL(currentIndexChanged(int)),
+               this, SLOT(perfPresetChanged(int)));
+    m_performancePreset->setCurrentIndex(presetForSelector(perfSelector()));
     connect(m_performancePreset, SIGNAL(currentIndexChanged(int)),
             this, SLOT(perfPresetChanged(int)));
 }
+
+/* Packs the settings we learn from into a single value for the history
+ * file.  Bits 0-5 are the same selector used for the performance presets. */
+quint32 Launcher::settingsKey(const ConnectionSettings &connection)
+{
+    quint32 key = 0;
+    if (connection.wallpaper)
+        key |= (1<<0);
+    if (connection.fontSmoothing)
+        key |= (1<<1);
+    if (connection.aero)
+        key |= (1<<2);
+    if (connection.windowDrag)
+        key |= (1<<3);
+    if (connection.menuAnims)
+        key |= (1<<4);
+    if (connection.themes)
+        key |= (1<<5);
+    if (connection.bitmapCache)
+        key |= (1<<6);
+    if (connection.offscreenCache)
+        key |= (1<<7);
+    if (connection.glyphCache)
+        key |= (1<<8);
+    key |= (qMax(0, s_depths.indexOf(connection.bpp)) & 0x3) << 9;
+    key |= (connection.compression & 0x7) << 11;
+    if (connection.jpeg)
+        key |= (1<<14);
+    return key;
+}
+
+void Launcher::applySettingsKey(quint32 key)
+{
+    uint selector = key & 0x3F;
+    PerformancePreset preset = presetForSelector(selector);
+    if (preset != PP_Custom) {
+        m_performancePreset->setCurrentIndex(preset);
+    } else {
+        m_wallpaper->setChecked(selector & (1<<0));
+        m_fontSmoothing->setChecked(selector & (1<<1));
+        m_aero->setChecked(selector & (1<<2));
+        m_windowDrag->setChecked(selector & (1<<3));
+        m_menuAnims->setChecked(selector & (1<<4));
+        m_themes->setChecked(selector & (1<<5));
+    }
+    m_bitmapCache->setChecked(key & (1<<6));
+    m_offscreenCache->setChecked(key & (1<<7));
+    m_glyphCache->setChecked(key & (1<<8));
+    m_depth->setCurrentIndex((key >> 9) & 0x3);
+    m_compression->setCurrentIndex(qMin<int>((key >> 11) & 0x7, m_compression->count() - 1));
+    m_jpeg->setChecked(key & (1<<14));
+}
+
+void Launcher::updateRecommendation()
+{
+    quint32 key;
+    int sessions, abnormal;
+    if (!recommendSettings(m_history.value(m_server->currentText()), &key,
+                           &sessions, &abnormal)) {
+        m_learnedHint->setText(tr("Not enough history for this server yet."));
+        m_applyLearned->setEnabled(false);
+        return;
+    }
+
+    m_learnedKey = key;
+    m_learnedHint->setText(tr("Best results for this server: %1, %2 bpp (%3 sessions, %4 abnormal)")
+                           .arg(m_performancePreset->itemText(presetForSelector(key & 0x3F)))
+                           .arg(s_depths[(key >> 9) & 0x3])
+                           .arg(sessions).arg(abnormal));
+    if (m_autoApplyLearned->isChecked())
+        applySettingsKey(key);
+    m_applyLearned->setEnabled(key != settingsKey(connectionSettings()));
+}
+
+MemorySettings Launcher::memorySettings(const ConnectionSettings &connection) const
+{
+    MemorySettings settings;
+    switch (static_cast<ResolutionType>(connection.resolutionType)) {
+    case RT_Standard:
+        settings.size = connection.standardSize;
+        break;
+    case RT_Custom:
+        settings.size = connection.customSize;
+        break;
+    case RT_Fullscreen:
+    case RT_RemoteApp:
+        // RemoteApp windows are drawn into a surface covering the whole desktop
+        settings.size = QApplication::desktop()->screenGeometry(this).size();
+        break;
+    }
+    settings.bpp = connection.bpp;
+    settings.jpeg = connection.jpeg;
+    settings.bitmapCache = connection.bitmapCache;
+    settings.offscreenCache = connection.offscreenCache;
+    settings.glyphCache = connection.glyphCache;
+    return settings;
+}
+
+bool Launcher::memoryHeadroom(qint64 *headroom) const
+{
+    if (m_memoryBudget->value() > 0) {
+        *headroom = static_cast<qint64>(m_memoryBudget->value()) * 1024 * 1024
+                  - m_runningMemory;
+        return true;
+    }
+
+    // MemAvailable already accounts for the sessions which are running
+    *headroom = availableMemory();
+    return *headroom >= 0;
+}
+
+void Launcher::refreshRunningMemory()
+{
+    m_runningMemory = runningClientMemory();
+    updateMemoryEstimate();
+}
+
+void Launcher::updateMemoryEstimate()
+{
+    qint64 estimate = estimateClientMemory(memorySettings(connectionSettings()));
+    qint64 headroom;
+    if (!memoryHeadroom(&headroom)) {
+        m_memoryHint->setText(tr("Estimated client memory: up to %1 MiB")
+                              .arg(estimate / (1024 * 1024)));
+    } else if (estimate > headroom) {
+        m_memoryHint->setText(tr("Estimated client memory: up to %1 MiB, but only %2 MiB "
+                                 "is left in the memory budget")
+                              .arg(estimate / (1024 * 1024))
+                              .arg(qMax<qint64>(0, headroom) / (1024 * 1024)));
+    } else {
+        m_memoryHint->setText(tr("Estimated client memory: up to %1 MiB of %2 MiB left")
+                              .arg(estimate / (1024 * 1024))
+                              .arg(headroom / (1024 * 1024)));
+    }
+}
+
+bool Launcher::fitMemoryBudget(ConnectionSettings *connection)
+{
+    // Sessions may have come or gone since the last refresh
+    m_runningMemory = runningClientMemory();
+    qint64 headroom;
+    if (!memoryHeadroom(&headroom))
+        return true;
+    auto fits = [this, connection, headroom]()
+    {
+        return estimateClientMemory(memorySettings(*connection)) <= headroom;
+    };
+    if (fits())
+        return true;
+
+    if (m_memoryPolicy->currentIndex() == MP_Downgrade) {
+        // Drop whatever costs the most for the least visible difference
+        // first, and never touch the resolution the user asked for
+        const ConnectionSettings original = *connection;
+        QStringList lowered;
+        if (!fits() && connection->offscreenCache) {
+            connection->offscreenCache = false;
+            lowered.append(tr("offscreen cache off"));
+        }
+        if (!fits() && connection->bitmapCache) {
+            connection->bitmapCache = false;
+            lowered.append(tr("bitmap cache off"));
+        }
+        if (!fits() && connection->jpeg) {
+            connection->jpeg = false;
+            lowered.append(tr("JPEG off"));
+        }
+        if (!fits() && connection->glyphCache) {
+            connection->glyphCache = false;
+            lowered.append(tr("glyph cache off"));
+        }
+        if (!fits() && connection->bpp > 16) {
+            connection->bpp = 16;
+            lowered.append(tr("16 bpp"));
+        }
+        if (fits()) {
+            QMessageBox::information(this, tr("Memory budget"),
+                    tr("To fit the memory budget, this session will use: %1.\n\n"
+                       "Your saved settings are not changed.")
+                    .arg(lowered.join(QStringLiteral(", "))));
+            return true;
+        }
+
+        // Connecting anyway means connecting with what the user chose
+        *connection = original;
+    }
+
+    return QMessageBox::warning(this, tr("Memory budget"),
+                tr("This session may need up to %1 MiB, but only %2 MiB is left in the "
+                   "memory budget.\n\nConnect anyway?")
+                .arg(estimateClientMemory(memorySettings(*connection)) / (1024 * 1024))
+                .arg(qMax<qint64>(0, headroom) / (1024 * 1024)),
+                QMessageBox::Yes | QMessageBox::No, QMessageBox::No) == QMessageBox::Yes;
+}
+
+void Launcher::prefetchCertificate()
+{
+    // Don't swap the certificate out from under a waiting connection
+    if (m_certPending)
+        return;
+    if (m_certPolicy->currentIndex() == CP_Ask || m_server->currentText().isEmpty()) {
+        m_certStatus->clear();
+        return;
+    }
+    if (!m_sshJumpHost->text().isEmpty()) {
+        // The tunnel only exists once we connect
+        m_certStatus->setText(tr("The certificate will be checked through the SSH tunnel "
+                                 "when connecting."));
+        return;
+    }
+
+    QString host;
+    quint16 port;
+    splitServer(m_server->currentText(), &host, &port);
+    if (m_certFetcher->host() == host && m_certFetcher->port() == port
+            && (m_certFetcher->isRunning() || m_certFetcher->result().fetched)) {
+        updateCertificateStatus();
+        return;
+    }
+    m_certStatus->setText(tr("Fetching the certificate from %1...").arg(host));
+    m_certFetcher->fetch(host, port, host);
+}
+
+void Launcher::updateCertificateStatus()
+{
+    if (m_certPolicy->currentIndex() == CP_Ask || m_certFetcher->isRunning()
+            || m_certFetcher->result().msecs < 0)
+        return;
+
+    CertificateCheck check = m_certFetcher->result();
+    QString status;
+    QString reason;
+    QString fingerprint = check.fingerprint.left(16) + QStringLiteral("...");
+    if (!check.fetched) {
+        status = tr("Could not fetch the certificate: %1").arg(check.error);
+    } else if (certificateAccepted(check, static_cast<CertPolicy>(m_certPolicy->currentIndex()),
+                                   m_certFingerprint->text(), &reason)) {
+        status = tr("Certificate %1 fetched in %2 ms and trusted.")
+                .arg(fingerprint).arg(check.msecs);
+    } else {
+        status = tr("Certificate %1 fetched in %2 ms, but not trusted: %3")
+                .arg(fingerprint).arg(check.msecs).arg(reason);
+    }
+
+    // Shows whether prefetching keeps the check off the connect path
+    auto wait = m_certWaits.constFind(m_server->currentText());
+    if (wait != m_certWaits.constEnd())
+        status += QLatin1Char(' ') + tr("The last connection waited %1 ms for it.")
+                .arg(wait->toLongLong());
+    m_certStatus->setText(status);
+    m_certStatus->setToolTip(check.fetched ? check.fingerprint : QString());
+}
+
+void Launcher::certificateFetched()
+{
+    if (!m_certPending || m_certFetcher->isRunning())
+        return;
+    m_certPending = false;
+
+    // Kept with the settings, since the dialog closes once we connect
+    if (g_traceEnabled)
+        traceSpan("certificateWait", m_certTraceBegin, traceClock());
+    m_certWaits.insert(m_server->currentText(), m_certWaited.elapsed());
+    CertificateCheck check = m_certFetcher->result();
+    updateCertificateStatus();
+
+    CertPolicy policy = static_cast<CertPolicy>(m_certPolicy->currentIndex());
+    QString reason;
+    if (!certificateAccepted(check, policy, m_certFingerprint->text(), &reason)) {
+        if (check.fetched && policy == CP_TrustOnFirstUse) {
+            if (QMessageBox::warning(this, tr("Certificate changed"),
+                        tr("The certificate for %1 has changed since it was first trusted.\n\n"
+                           "New SHA-256 fingerprint:\n%2\n\nTrust the new certificate?")
+                        .arg(m_certFetcher->peerName(), check.fingerprint),
+                        QMessageBox::Yes | QMessageBox::No, QMessageBox::No) != QMessageBox::Yes) {
+                abortConnect();
+                return;
+            }
+        } else {
+            abortConnect();
+            QMessageBox::critical(this, tr("Untrusted certificate"),
+                                  tr("Not connecting to %1:\n%2")
+                                  .arg(m_certFetcher->peerName(), reason));
+            return;
+        }
+    }
+
+    if (policy == CP_TrustOnFirstUse)
+        m_certFingerprint->setText(check.fingerprint);
+    m_verifiedFingerprint = check.fingerprint;
+    startSession(m_pendingHost, m_pendingPort, m_pendingTarget);
+}
+
+void Launcher::serverChanged(const QString &server)
+{
+    if (server == m_loadedServer)
+        return;
+    m_loadedServer = server;
+
+    // Switching between servers without a shared profile keeps whatever
+    // the user has already changed in the dialog
+    QVariantMap profile = m_profiles->profile(server);
+    if (!profile.isEmpty() || !m_appliedProfile.isEmpty()) {
+        loadSettings(profile);
+    } else {
+        m_sshJumpHost->setText(m_sshJumpHosts.value(server).toString());
+        m_certPolicy->setCurrentIndex(m_certPolicies.value(server, CP_Ask).toInt());
+        m_certFingerprint->setText(m_certFingerprints.value(server).toString());
+    }
+    updateRecommendation();
+}
+
+void Launcher::profilesChanged(const QStringList &servers)
+{
+    QString currentServer = m_server->currentText();
+    {
+        QSignalBlocker blocker(m_server);
+        for (const QString &server : m_profiles->servers()) {
+            if (m_server->findText(server) < 0)
+                m_server->addItem(server);
+        }
+        m_server->setCurrentText(currentServer);
+    }
+
+    if (servers.contains(currentServer))
+        loadSettings(m_profiles->profile(currentServer));
+}
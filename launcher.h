@@ -19,31 +19,33 @@
 #define _QFREERDP_LAUNCHER_H
 
 #include <QDialog>
+#include <QElapsedTimer>
+#include <QVariantMap>
+#include "client.h"
+#include "history.h"
+#include "params.h"
 
 class QLineEdit;
 class QComboBox;
 class QCheckBox;
 class QSlider;
+class QSpinBox;
+class QDoubleSpinBox;
+class QLabel;
+class QPushButton;
+class QTabWidget;
+class ProfileStore;
+class CertificateFetcher;
+class QTimer;
+class Session;
+class SshTunnel;
+struct MemorySettings;
 
 class Launcher : public QDialog
 {
     Q_OBJECT
 
 public:
-    enum ResolutionType
-    {
-        RT_Standard,
-        RT_Custom,
-        RT_Fullscreen
-    };
-
-    enum CompressionType
-    {
-        CT_Disabled,
-        CT_Default,
-        CT_Level
-    };
-
     enum PerformancePreset
     {
         PP_Minimum,
@@ -53,17 +55,65 @@ public:
         PP_Custom
     };
 
-    Launcher();
+    enum MemoryPolicy
+    {
+        MP_Warn,
+        MP_Downgrade
+    };
+
+    /* The profile store may be shared with a resident instance, so it
+     * outlives the dialog */
+    explicit Launcher(const ClientInfo &client, ProfileStore *profiles = Q_NULLPTR);
 
     void saveConfig();
     void restoreConfig();
 
+    /* A resident instance stays running anyway, so it watches every
+     * session and learns from all of them */
+    void setResident(bool resident) { m_resident = resident; }
+
+    /* Connects with the saved settings once the dialog is up, for
+     * scripted launches */
+    void connectWithPassword(const QString &password);
+
 private slots:
     void startXFreeRDP();
     void perfPresetChanged(int index);
     void perfItemChanged(bool);
+    void serverChanged(const QString &server);
+    void profilesChanged(const QStringList &servers);
+    void updateMemoryEstimate();
+    void refreshRunningMemory();
+    void prefetchCertificate();
+    void updateCertificateStatus();
+    void certificateFetched();
+    void tunnelOpened();
+    void tunnelFailed(const QString &error);
 
 private:
+    void loadSettings(const QVariantMap &profile);
+    ConnectionSettings connectionSettings() const;
+    void applyConnectionSettings(const ConnectionSettings &connection);
+
+    uint perfSelector() const;
+    static quint32 settingsKey(const ConnectionSettings &connection);
+    void applySettingsKey(quint32 key);
+    void updateRecommendation();
+
+    MemorySettings memorySettings(const ConnectionSettings &connection) const;
+    bool memoryHeadroom(qint64 *headroom) const;
+    bool fitMemoryBudget(ConnectionSettings *connection);
+
+    void connectTo(const QString &host, quint16 port, const QString &tunnelTarget);
+    void startSession(const QString &host, quint16 port, const QString &tunnelTarget);
+    void abortConnect();
+    void setConnecting(bool connecting);
+
+    ProfileStore *m_profiles;
+    bool m_resident;
+    QVariantMap m_appliedProfile;  // Shown instead of, never saved over, the user's own
+    QString m_loadedServer;
+
     // General
     QComboBox *m_server;
     QLineEdit *m_username;
@@ -74,8 +124,12 @@ private:
     QSlider *m_resolution;
     QLineEdit *m_customWidth;
     QLineEdit *m_customHeight;
+    QLineEdit *m_remoteApp;
+    QLineEdit *m_remoteAppArgs;
+    QLineEdit *m_remoteAppDirectory;
     QComboBox *m_depth;
     QList<QSize> m_availableResolutions;
+    QLabel *m_memoryHint;
 
     QComboBox *m_compression;
     QCheckBox *m_jpeg;
@@ -100,11 +154,63 @@ private:
     QCheckBox *m_offscreenCache;
     QCheckBox *m_glyphCache;
 
+    QLabel *m_learnedHint;
+    QPushButton *m_applyLearned;
+    QCheckBox *m_autoApplyLearned;
+    QHash<QString, QList<SessionRecord>> m_history;
+    quint32 m_learnedKey;
+
     // Advanced
     QLineEdit *m_gateServer;
     QLineEdit *m_gateUsername;
     QLineEdit *m_gatePassword;
+    QLineEdit *m_sshJumpHost;
+    QVariantMap m_sshJumpHosts;
+    QComboBox *m_client;
+    QString m_defaultClient;
+    QHash<QString, ClientInfo> m_clientInfo;
     QLineEdit *m_extraParams;
+    QCheckBox *m_captureLogs;
+    QSpinBox *m_memoryBudget;
+    QComboBox *m_memoryPolicy;
+    QTimer *m_memoryRefresh;
+    qint64 m_runningMemory;     // Of all clients, as of the last refresh
+    QComboBox *m_certPolicy;
+    QLineEdit *m_certFingerprint;
+    QLabel *m_certStatus;
+    QVariantMap m_certPolicies;
+    QVariantMap m_certFingerprints;
+    QVariantMap m_certWaits;    // How long the last connection waited, in ms
+    CertificateFetcher *m_certFetcher;
+    QTimer *m_certPrefetch;
+    QString m_verifiedFingerprint;
+
+    // Testing
+    QCheckBox *m_netEmu;
+    QSpinBox *m_netLatency;
+    QSpinBox *m_netJitter;
+    QSpinBox *m_netBandwidth;
+    QDoubleSpinBox *m_netLoss;
+    QSpinBox *m_netStallInterval;
+    QSpinBox *m_netStallLength;
+    QCheckBox *m_recordTraffic;
+
+    QTabWidget *m_tabs;
+    QPushButton *m_connectButton;
+
+    // A connection waiting on the SSH tunnel
+    Session *m_session;
+    SshTunnel *m_tunnel;
+    ClientInfo m_sessionClient;
+    ConnectionSettings m_sessionSettings;
+
+    // A connection waiting on the certificate
+    bool m_certPending;
+    QString m_pendingHost;
+    quint16 m_pendingPort;
+    QString m_pendingTarget;
+    QElapsedTimer m_certWaited;
+    qint64 m_certTraceBegin;
 };
 
 #endif
@@ -16,46 +16,151 @@
  */
 
 #include "launcher.h"
-#include "qfreerdp.h"
+#include "client.h"
+#include "profiles.h"
+#include "replay.h"
+#include "resident.h"
+#include "session.h"
+#include "trace.h"
 #include <QApplication>
-#include <QProcess>
-#include <QRegularExpression>
+#include <QCoreApplication>
+#include <QPointer>
+#include <csignal>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
-static const QRegularExpression re_version("FreeRDP version ([0-9.]*)");
+static bool parseRuns(const char *text, int *runs)
+{
+    char *end;
+    long value = strtol(text, &end, 10);
+    if (*text == '\0' || *end != '\0' || value < 1 || value > 10000)
+        return false;
+    *runs = static_cast<int>(value);
+    return true;
+}
 
 int main(int argc, char *argv[])
 {
+    initTrace();
+    bool resident = (argc > 1 && strcmp(argv[1], "--resident") == 0);
+    bool connectNow = (argc > 1 && strcmp(argv[1], "--connect") == 0);
+
+    if (argc > 1 && strcmp(argv[1], "--dump-logs") == 0) {
+        if (!forwardToResident("dump-logs")) {
+            fputs("No resident qfreerdp instance is running.  To flush a launcher kept\n"
+                  "running by a session, send it SIGUSR1 instead.\n", stderr);
+            return 1;
+        }
+        return 0;
+    }
+
+    if (argc > 1 && (strcmp(argv[1], "--compare-clients") == 0
+                     || strcmp(argv[1], "--replay-bench") == 0)) {
+        if (argc < 3) {
+            fprintf(stderr, "Usage: %s %s <capture> [runs]\n", argv[0], argv[1]);
+            return 2;
+        }
+        int runs = 3;
+        if (argc > 3 && !parseRuns(argv[3], &runs)) {
+            fprintf(stderr, "Invalid number of runs: %s\n", argv[3]);
+            return 2;
+        }
+        QCoreApplication app(argc, argv);
+        QString capture = QString::fromLocal8Bit(argv[2]);
+        if (strcmp(argv[1], "--compare-clients") == 0)
+            return compareClients(capture, runs);
+        return replayBenchmark(capture, runs);
+    }
+
+    // If a resident instance is already running, let it show the dialog
+    // instead of paying for our own Qt startup and version check
+    if (!resident && !connectNow && forwardToResident("show"))
+        return 0;
+
+    // Scripted launches hand us the password on stdin, never in argv
+    QString password;
+    if (connectNow) {
+        char line[1024];
+        if (fgets(line, sizeof(line), stdin))
+            password = QString::fromLocal8Bit(line).remove(QLatin1Char('\n'));
+    }
+
+    const int64_t startupBegin = g_traceEnabled ? traceClock() : 0;
     QApplication app(argc, argv);
 
     // Perform some sanity checks early
-    auto result = queryXFreeRDP(QStringLiteral("--version"));
-    if (!result.second) {
-        fputs("Error starting xfreerdp.  Is it in your PATH?\n", stderr);
+    ClientInfo client;
+    bool probed;
+    {
+        TRACE_SCOPE("probeClient");
+        probed = probeClient(defaultClient(), &client);
+    }
+    if (!probed) {
+        fprintf(stderr, "Error starting %s.  Is it in your PATH?\n",
+                client.program.toLocal8Bit().constData());
         return 2;
     }
-    QString version;
-    for (QByteArray line : result.first.split('\n')) {
-        auto strLine = QString::fromLocal8Bit(line);
-        auto match = re_version.match(strLine);
-        if (!match.hasMatch())
-            continue;
-        version = match.captured(1);
-        break;
-    }
-    if (version.isEmpty()) {
-        fputs("Could not determine xfreerdp version\n", stderr);
+    if (client.version.isEmpty()) {
+        fprintf(stderr, "Could not determine %s version\n",
+                client.program.toLocal8Bit().constData());
         return 1;
     }
-    if (!version.startsWith("2.")) {
-        fprintf(stderr, "xfreerdp reported version %s, but we require at least 2.0\n",
-                version.toUtf8().data());
+    if (client.major != 2 && client.major != 3) {
+        fprintf(stderr, "%s reported version %s, but we require FreeRDP 2.x or 3.x\n",
+                client.program.toLocal8Bit().constData(), client.version.toUtf8().data());
         return 1;
     }
 
+    if (resident) {
+        // Stay around without any windows, and only build the dialog when
+        // another invocation asks for it.  The dialog is destroyed again
+        // when closed to keep our idle footprint small, but the profiles,
+        // session history and client version stay loaded.
+        ResidentServer server;
+        if (!server.listen()) {
+            fputs("Could not start resident instance.  Is one already running?\n", stderr);
+            return 1;
+        }
+        app.setQuitOnLastWindowClosed(false);
+        QObject::connect(&server, &ResidentServer::quitRequested,
+                         &app, &QCoreApplication::quit);
+        ProfileStore profiles;
+
+        QPointer<Launcher> launcher;
+        QObject::connect(&server, &ResidentServer::showRequested,
+                         [&launcher, &client, &profiles]()
+        {
+            TRACE_SCOPE("showLauncher");
+            if (!launcher) {
+                launcher = new Launcher(client, &profiles);
+                launcher->setAttribute(Qt::WA_DeleteOnClose);
+                launcher->setResident(true);
+                launcher->restoreConfig();
+            }
+            launcher->show();
+            launcher->raise();
+            launcher->activateWindow();
+        });
+        QObject::connect(&server, &ResidentServer::dumpLogsRequested, &Session::flushAllLogs);
+        if (g_traceEnabled)
+            traceSpan("startup", startupBegin, traceClock());
+        return app.exec();
+    }
+
+    // Captured sessions keep us running after the dialog closes, so allow
+    // their logs to be flushed the same way as a resident instance's
+    SignalNotifier notifier;
+    if (notifier.watch(SIGUSR1))
+        QObject::connect(&notifier, &SignalNotifier::raised, &Session::flushAllLogs);
+
     // Show the GUI
-    Launcher launcher;
+    Launcher launcher(client);
     launcher.restoreConfig();
     launcher.show();
+    if (g_traceEnabled)
+        traceSpan("startup", startupBegin, traceClock());
+    if (connectNow)
+        launcher.connectWithPassword(password);
     return app.exec();
 }
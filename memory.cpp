@@ -0,0 +1,106 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "memory.h"
+
+#include <QDir>
+#include <QFile>
+
+/* Libraries, X connection and channel buffers, as measured for an idle
+ * xfreerdp session with nothing cached */
+static const qint64 s_clientBase = 40 * 1024 * 1024;
+
+/* FreeRDP's default cache sizes.  The bitmap cache holds 600 16x16,
+ * 600 32x32 and 2048 64x64 tiles; the offscreen cache is specified by
+ * the protocol in KiB; the glyph cache is ten caches of up to 254 glyphs
+ * plus the fragment cache. */
+static const qint64 s_bitmapCachePixels = 600 * 16 * 16 + 600 * 32 * 32 + 2048 * 64 * 64;
+static const qint64 s_offscreenCacheBytes = 7680 * 1024;
+static const qint64 s_glyphCacheBytes = 4 * 1024 * 1024;
+
+/* Process names as they appear in /proc/<pid>/comm */
+static const char *s_clientNames[] = {
+    "xfreerdp",
+    "xfreerdp3",
+    "sdl-freerdp",
+    "sdl-freerdp3"
+};
+
+qint64 estimateClientMemory(const MemorySettings &settings)
+{
+    const qint64 pixels = static_cast<qint64>(settings.size.width()) * settings.size.height();
+    const int bytesPerPixel = (settings.bpp + 7) / 8;
+
+    // The GDI surface plus the image it's copied to for the X server,
+    // which is always 32 bpp
+    qint64 total = s_clientBase + pixels * bytesPerPixel + pixels * 4;
+    if (settings.jpeg)
+        total += pixels * 4;
+    if (settings.bitmapCache)
+        total += s_bitmapCachePixels * bytesPerPixel;
+    if (settings.offscreenCache)
+        total += s_offscreenCacheBytes;
+    if (settings.glyphCache)
+        total += s_glyphCacheBytes;
+    return total;
+}
+
+static qint64 statusField(const QByteArray &status, const char *field)
+{
+    for (QByteArray line : status.split('\n')) {
+        if (line.startsWith(field))
+            return line.mid(qstrlen(field)).trimmed().split(' ').first().toLongLong() * 1024;
+    }
+    return 0;
+}
+
+qint64 runningClientMemory()
+{
+    qint64 total = 0;
+    QDir proc(QStringLiteral("/proc"));
+    for (const QString &pid : proc.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        if (!pid.at(0).isDigit())
+            continue;
+        QFile comm(proc.filePath(pid + QStringLiteral("/comm")));
+        if (!comm.open(QIODevice::ReadOnly))
+            continue;
+        QByteArray name = comm.readAll().trimmed();
+        bool isClient = false;
+        for (const char *client : s_clientNames) {
+            if (name == client) {
+                isClient = true;
+                break;
+            }
+        }
+        if (!isClient)
+            continue;
+
+        QFile status(proc.filePath(pid + QStringLiteral("/status")));
+        if (status.open(QIODevice::ReadOnly))
+            total += statusField(status.readAll(), "VmRSS:");
+    }
+    return total;
+}
+
+qint64 availableMemory()
+{
+    QFile meminfo(QStringLiteral("/proc/meminfo"));
+    if (!meminfo.open(QIODevice::ReadOnly))
+        return -1;
+    qint64 available = statusField(meminfo.readAll(), "MemAvailable:");
+    return available > 0 ? available : -1;
+}
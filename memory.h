@@ -0,0 +1,47 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _QFREERDP_MEMORY_H
+#define _QFREERDP_MEMORY_H
+
+#include <QSize>
+
+struct MemorySettings
+{
+    MemorySettings()
+        : bpp(32), jpeg(false), bitmapCache(true), offscreenCache(true),
+          glyphCache(true) { }
+
+    QSize size;
+    int bpp;
+    bool jpeg;
+    bool bitmapCache;
+    bool offscreenCache;
+    bool glyphCache;
+};
+
+/* Rough worst case for one client process with these settings, in bytes.
+ * Caches are counted as if the server filled them completely. */
+qint64 estimateClientMemory(const MemorySettings &settings);
+
+/* Resident memory of every FreeRDP client on this host, in bytes */
+qint64 runningClientMemory();
+
+/* MemAvailable from the kernel, in bytes, or -1 if unknown */
+qint64 availableMemory();
+
+#endif
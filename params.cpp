@@ -0,0 +1,313 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "params.h"
+
+#include "qfreerdp.h"
+#include "client.h"
+#include "trace.h"
+#include <QCoreApplication>
+
+static QString trParams(const char *text)
+{
+    return QCoreApplication::translate("ConnectionSettings", text);
+}
+
+ConnectionSettings readConnectionSettings(const SettingsReader &value)
+{
+    ConnectionSettings connection;
+
+    // Display
+    connection.resolutionType = value(QStringLiteral("ResolutionType"),
+                                      QStringLiteral("0")).toInt();
+    connection.standardSize = value(QStringLiteral("StandardResolution"), QVariant()).toSize();
+    connection.customSize = value(QStringLiteral("CustomResolution"), QSize(0, 0)).toSize();
+    connection.remoteApp = value(QStringLiteral("RemoteAppProgram"), QVariant()).toString();
+    connection.remoteAppArgs = value(QStringLiteral("RemoteAppArgs"), QVariant()).toString();
+    connection.remoteAppDirectory = value(QStringLiteral("RemoteAppDirectory"),
+                                          QVariant()).toString();
+    connection.bpp = value(QStringLiteral("BitDepth"), QStringLiteral("32")).toInt();
+
+    connection.compression = value(QStringLiteral("CompressionType"),
+                                   QStringLiteral("1")).toInt();
+    connection.jpeg = value(QStringLiteral("Jpeg"), QStringLiteral("false")).toBool();
+    connection.jpegQuality = value(QStringLiteral("JpegLevel"), QStringLiteral("95")).toInt();
+
+    // Devices
+    connection.audioMode = value(QStringLiteral("AudioMode"), QStringLiteral("0")).toInt();
+    connection.clipboard = value(QStringLiteral("Clipboard"), QStringLiteral("true")).toBool();
+    connection.redirectDrives = value(QStringLiteral("RedirectDrives"),
+                                      QStringLiteral("false")).toBool();
+    connection.redirectHome = value(QStringLiteral("RedirectHome"),
+                                    QStringLiteral("false")).toBool();
+
+    // Experience
+    connection.wallpaper = value(QStringLiteral("Wallpaper"), QStringLiteral("true")).toBool();
+    connection.fontSmoothing = value(QStringLiteral("FontSmoothing"),
+                                     QStringLiteral("true")).toBool();
+    connection.aero = value(QStringLiteral("Aero"), QStringLiteral("true")).toBool();
+    connection.windowDrag = value(QStringLiteral("WindowDrag"), QStringLiteral("true")).toBool();
+    connection.menuAnims = value(QStringLiteral("MenuAnims"), QStringLiteral("true")).toBool();
+    connection.themes = value(QStringLiteral("Themes"), QStringLiteral("true")).toBool();
+    connection.bitmapCache = value(QStringLiteral("BitmapCache"),
+                                   QStringLiteral("true")).toBool();
+    connection.offscreenCache = value(QStringLiteral("OffscreenCache"),
+                                      QStringLiteral("true")).toBool();
+    connection.glyphCache = value(QStringLiteral("GlyphCache"), QStringLiteral("true")).toBool();
+
+    // Advanced
+    connection.gateway = value(QStringLiteral("Gateway"), QVariant()).toString();
+    connection.gatewayUsername = value(QStringLiteral("GatewayUsername"), QVariant()).toString();
+    connection.extraParams = value(QStringLiteral("ExtraParams"), QVariant()).toString();
+    return connection;
+}
+
+void writeConnectionSettings(const SettingsWriter &setValue, const ConnectionSettings &connection)
+{
+    // Display
+    setValue(QStringLiteral("ResolutionType"), connection.resolutionType);
+    setValue(QStringLiteral("StandardResolution"), connection.standardSize);
+    setValue(QStringLiteral("CustomResolution"), connection.customSize);
+    setValue(QStringLiteral("RemoteAppProgram"), connection.remoteApp);
+    setValue(QStringLiteral("RemoteAppArgs"), connection.remoteAppArgs);
+    setValue(QStringLiteral("RemoteAppDirectory"), connection.remoteAppDirectory);
+    setValue(QStringLiteral("BitDepth"), connection.bpp);
+
+    setValue(QStringLiteral("CompressionType"), connection.compression);
+    setValue(QStringLiteral("Jpeg"), connection.jpeg);
+    setValue(QStringLiteral("JpegLevel"), connection.jpegQuality);
+
+    // Devices
+    setValue(QStringLiteral("AudioMode"), connection.audioMode);
+    setValue(QStringLiteral("Clipboard"), connection.clipboard);
+    setValue(QStringLiteral("RedirectDrives"), connection.redirectDrives);
+    setValue(QStringLiteral("RedirectHome"), connection.redirectHome);
+
+    // Experience
+    setValue(QStringLiteral("Wallpaper"), connection.wallpaper);
+    setValue(QStringLiteral("FontSmoothing"), connection.fontSmoothing);
+    setValue(QStringLiteral("Aero"), connection.aero);
+    setValue(QStringLiteral("WindowDrag"), connection.windowDrag);
+    setValue(QStringLiteral("MenuAnims"), connection.menuAnims);
+    setValue(QStringLiteral("Themes"), connection.themes);
+
+    setValue(QStringLiteral("BitmapCache"), connection.bitmapCache);
+    setValue(QStringLiteral("OffscreenCache"), connection.offscreenCache);
+    setValue(QStringLiteral("GlyphCache"), connection.glyphCache);
+
+    // Advanced
+    setValue(QStringLiteral("Gateway"), connection.gateway);
+    setValue(QStringLiteral("GatewayUsername"), connection.gatewayUsername);
+    setValue(QStringLiteral("ExtraParams"), connection.extraParams);
+}
+
+static bool validDimension(int value)
+{
+    return value >= 100 && value <= 65535;
+}
+
+bool validateSettings(const ConnectionSettings &connection, int major, QString *error)
+{
+    if (connection.server.isEmpty()) {
+        *error = trParams("Server name must not be empty.");
+        return false;
+    }
+    if (connection.username.isEmpty()) {
+        *error = trParams("Username must not be empty.");
+        return false;
+    }
+    if (connection.password.isEmpty()) {
+        *error = trParams("Password must not be empty.");
+        return false;
+    }
+    if (connection.resolutionType == RT_Custom
+            && (!validDimension(connection.customSize.width())
+                || !validDimension(connection.customSize.height()))) {
+        *error = trParams("Invalid custom resolution specified");
+        return false;
+    }
+    if (connection.resolutionType == RT_RemoteApp && connection.remoteApp.isEmpty()) {
+        *error = trParams("RemoteApp program must not be empty.");
+        return false;
+    }
+
+    // FreeRDP 3 takes these as parts of a single comma separated /app: or
+    // /gateway: option, with no way to escape a comma inside a value
+    if (major >= 3) {
+        QList<QPair<QString, QString>> listed;
+        if (connection.resolutionType == RT_RemoteApp) {
+            listed.append(qMakePair(trParams("RemoteApp program"), connection.remoteApp));
+            listed.append(qMakePair(trParams("RemoteApp arguments"), connection.remoteAppArgs));
+            listed.append(qMakePair(trParams("RemoteApp working directory"),
+                                    connection.remoteAppDirectory));
+        }
+        listed.append(qMakePair(trParams("Gateway server"), connection.gateway));
+        if (!connection.gatewayUsername.isEmpty()) {
+            listed.append(qMakePair(trParams("Gateway username"), connection.gatewayUsername));
+            listed.append(qMakePair(trParams("Gateway password"), connection.gatewayPassword));
+        }
+        for (const auto &value : listed) {
+            if (value.second.contains(QLatin1Char(','))) {
+                *error = trParams("%1 must not contain a comma with FreeRDP 3.x.")
+                         .arg(value.first);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+QStringList clientParams(const ConnectionSettings &connection, int major)
+{
+    TRACE_SCOPE("clientParams");
+    ClientOptions options(major);
+    // Replays have no server to log in to, so those may be left out
+    if (connection.target.isEmpty()) {
+        if (!connection.server.isEmpty())
+            options.add(CO_Server, connection.server);
+    } else {
+        // Still check the certificate against the real server's name
+        QString host;
+        quint16 port;
+        splitServer(connection.server, &host, &port);
+        options.add(CO_Server, connection.target);
+        options.add(CO_CertName, host);
+    }
+    if (!connection.certFingerprint.isEmpty())
+        options.add(CO_CertFingerprint, connection.certFingerprint);
+    if (!connection.username.isEmpty())
+        options.add(CO_Username, connection.username);
+
+    // xfreerdp will mask this out for us in the running process
+    if (!connection.password.isEmpty())
+        options.add(CO_Password, connection.password);
+
+    switch (static_cast<ResolutionType>(connection.resolutionType)) {
+    case RT_Standard:
+        options.add(CO_Size, QStringLiteral("%1x%2").arg(connection.standardSize.width())
+                                                    .arg(connection.standardSize.height()));
+        break;
+    case RT_Custom:
+        options.add(CO_Size, QStringLiteral("%1x%2").arg(connection.customSize.width())
+                                                    .arg(connection.customSize.height()));
+        break;
+    case RT_Fullscreen:
+        options.add(CO_Fullscreen);
+        break;
+    case RT_RemoteApp:
+        options.add(CO_RemoteApp, connection.remoteApp);
+        if (!connection.remoteAppArgs.isEmpty())
+            options.add(CO_RemoteAppArgs, connection.remoteAppArgs);
+        if (!connection.remoteAppDirectory.isEmpty())
+            options.add(CO_RemoteAppDirectory, connection.remoteAppDirectory);
+        break;
+    }
+
+    options.add(CO_BitDepth, QString::number(connection.bpp));
+
+    if (connection.compression == CT_Disabled)
+        options.toggle(CO_Compression, false);
+    else if (connection.compression == CT_Default)
+        options.toggle(CO_Compression, true);
+    else
+        options.add(CO_CompressionLevel, QString::number(connection.compression - CT_Level));
+
+    if (connection.jpeg) {
+        options.add(CO_Jpeg);
+        options.add(CO_JpegQuality, QString::number(connection.jpegQuality));
+    }
+
+    options.add(CO_AudioMode, QString::number(connection.audioMode));
+
+    options.toggle(CO_Clipboard, connection.clipboard);
+    options.toggle(CO_Drives, connection.redirectDrives);
+    options.toggle(CO_HomeDrive, connection.redirectHome);
+
+    options.toggle(CO_Fonts, connection.fontSmoothing);
+    options.toggle(CO_Aero, connection.aero);
+    options.toggle(CO_WindowDrag, connection.windowDrag);
+    options.toggle(CO_MenuAnims, connection.menuAnims);
+    options.toggle(CO_Themes, connection.themes);
+    options.toggle(CO_Wallpaper, connection.wallpaper);
+
+    options.toggle(CO_BitmapCache, connection.bitmapCache);
+    options.toggle(CO_OffscreenCache, connection.offscreenCache);
+    options.toggle(CO_GlyphCache, connection.glyphCache);
+
+    if (!connection.gateway.isEmpty())
+        options.add(CO_Gateway, connection.gateway);
+    if (!connection.gatewayUsername.isEmpty()) {
+        options.add(CO_GatewayUsername, connection.gatewayUsername);
+        options.add(CO_GatewayPassword, connection.gatewayPassword);
+    }
+
+    if (!connection.captureFile.isEmpty())
+        options.add(CO_Pcap, connection.captureFile);
+
+    options.append(splitParams(connection.extraParams));
+    return options.params();
+}
+
+static QString stripQuotes(QString text)
+{
+    if (text.at(0) == '"' && text.at(text.size() - 1) == '"')
+        text = text.mid(1, text.size() - 2);
+    else if (text.at(0) == '\'' && text.at(text.size() - 1) == '\'')
+        text = text.mid(1, text.size() - 2);
+    text.replace("\\\"", "\"").replace("\\'", "'");
+    return text;
+}
+
+QStringList splitParams(const QString &text)
+{
+    TRACE_SCOPE("splitParams");
+    QStringList result;
+    int start = 0;
+    int quotes = 0;
+    QChar last(0);
+    for (int cursor = 0; cursor < text.size(); ++cursor) {
+        QChar ch = text.data()[cursor];
+        if (quotes == 0 && ch == ' ') {
+            QString param = text.mid(start, cursor - start);
+            if (!param.isEmpty())
+                result.append(stripQuotes(param));
+            start = cursor + 1;
+        } else if (ch == '"') {
+            if (quotes == 2) {
+                if (last != '\\')
+                    quotes = 0;
+            } else if (quotes == 0) {
+                if (last != '\\')
+                    quotes = 2;
+            }
+        } else if (ch == '\'') {
+            if (quotes == 1) {
+                if (last != '\\')
+                    quotes = 0;
+            } else if (quotes == 0) {
+                if (last != '\\')
+                    quotes = 1;
+            }
+        }
+        last = ch;
+    }
+    QString remainder = text.mid(start);
+    if (!remainder.isEmpty())
+        result.append(stripQuotes(remainder));
+
+    return result;
+}
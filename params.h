@@ -0,0 +1,115 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _QFREERDP_PARAMS_H
+#define _QFREERDP_PARAMS_H
+
+#include <QSize>
+#include <QStringList>
+#include <QVariant>
+#include <functional>
+
+enum ResolutionType
+{
+    RT_Standard,
+    RT_Custom,
+    RT_Fullscreen,
+    RT_RemoteApp
+};
+
+enum CompressionType
+{
+    CT_Disabled,
+    CT_Default,
+    CT_Level
+};
+
+/* Everything that ends up on the client's command line, without any of
+ * the widgets it was entered in */
+struct ConnectionSettings
+{
+    ConnectionSettings()
+        : resolutionType(RT_Standard), customSize(0, 0), bpp(32),
+          compression(CT_Default), jpeg(false), jpegQuality(95), audioMode(0),
+          clipboard(true), redirectDrives(false), redirectHome(false),
+          wallpaper(true), fontSmoothing(true), aero(true), windowDrag(true),
+          menuAnims(true), themes(true), bitmapCache(true),
+          offscreenCache(true), glyphCache(true) { }
+
+    QString server;
+    QString username;
+    QString password;
+
+    int resolutionType;
+    QSize standardSize;     // Invalid until the launcher picks one
+    QSize customSize;
+    QString remoteApp;
+    QString remoteAppArgs;
+    QString remoteAppDirectory;
+    int bpp;
+
+    int compression;
+    bool jpeg;
+    int jpegQuality;
+
+    int audioMode;
+    bool clipboard;
+    bool redirectDrives;
+    bool redirectHome;
+
+    bool wallpaper;
+    bool fontSmoothing;
+    bool aero;
+    bool windowDrag;
+    bool menuAnims;
+    bool themes;
+    bool bitmapCache;
+    bool offscreenCache;
+    bool glyphCache;
+
+    QString gateway;
+    QString gatewayUsername;
+    QString gatewayPassword;
+    QString extraParams;
+
+    // Only known when connecting, and never saved
+    QString target;         // Where to connect instead of server, if set
+    QString certFingerprint;
+    QString captureFile;
+};
+
+/* Looks up a saved value, falling back to the given default */
+typedef std::function<QVariant (const QString &, const QVariant &)> SettingsReader;
+/* Saves a value, or leaves it alone */
+typedef std::function<void (const QString &, const QVariant &)> SettingsWriter;
+
+ConnectionSettings readConnectionSettings(const SettingsReader &value);
+void writeConnectionSettings(const SettingsWriter &setValue, const ConnectionSettings &connection);
+
+/* Returns false with a message for the user if a client of this FreeRDP
+ * major version can't be started with these settings */
+bool validateSettings(const ConnectionSettings &connection, int major, QString *error);
+
+/* The client's command line for a FreeRDP major version.  The settings
+ * are expected to have been validated already, except that the server and
+ * login are left out when empty. */
+QStringList clientParams(const ConnectionSettings &connection, int major);
+
+/* Splits extra parameters the way a shell would, honoring quotes */
+QStringList splitParams(const QString &text);
+
+#endif
@@ -0,0 +1,253 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "profiles.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileSystemWatcher>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QSettings>
+#include <QSize>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QtConcurrent/QtConcurrentRun>
+
+static const quint32 s_cacheVersion = 1;
+
+/* Directory watches only report files being added, removed or renamed,
+ * and none at all on network filesystems.  Edits made in place are found
+ * by a periodic pass which only stats unchanged files. */
+static const int s_pollInterval = 30 * 1000;
+
+static QString cachePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+            + QStringLiteral("/profiles.cache");
+}
+
+static QVariantMap parseProfile(const QByteArray &content, const QString &name)
+{
+    static const QRegularExpression re_size("^([0-9]+)x([0-9]+)$");
+
+    // Sections are ignored, so profiles may be written either flat or
+    // grouped however the administrator prefers
+    QVariantMap values;
+    values.insert(QStringLiteral("Server"), name);
+    for (const QByteArray &rawLine : content.split('\n')) {
+        QString line = QString::fromUtf8(rawLine).trimmed();
+        if (line.isEmpty() || line.startsWith('#') || line.startsWith(';')
+                || line.startsWith('['))
+            continue;
+        int split = line.indexOf('=');
+        if (split <= 0)
+            continue;
+        QString key = line.left(split).trimmed();
+        QString value = line.mid(split + 1).trimmed();
+        auto match = re_size.match(value);
+        if (match.hasMatch())
+            values.insert(key, QSize(match.captured(1).toInt(), match.captured(2).toInt()));
+        else
+            values.insert(key, value);
+    }
+    return values;
+}
+
+/* Runs on a worker thread, so it must only touch its arguments */
+static ProfileScan scanProfiles(const QString &path, const ProfileScan &previous)
+{
+    ProfileScan result;
+    QDir dir(path);
+    for (const QFileInfo &info : dir.entryInfoList(QStringList { QStringLiteral("*.ini") },
+                                                   QDir::Files | QDir::Readable)) {
+        ProfileFile entry;
+        entry.size = info.size();
+        entry.modified = info.lastModified().toMSecsSinceEpoch();
+
+        // Don't even open files which look unchanged
+        auto old = previous.files.constFind(info.fileName());
+        if (old != previous.files.constEnd() && old->size == entry.size
+                && old->modified == entry.modified && previous.parsed.contains(old->hash)) {
+            entry.hash = old->hash;
+            result.parsed.insert(entry.hash, previous.parsed.value(entry.hash));
+            result.files.insert(info.fileName(), entry);
+            continue;
+        }
+
+        QFile file(info.filePath());
+        if (!file.open(QIODevice::ReadOnly))
+            continue;
+        QByteArray content = file.readAll();
+        entry.hash = QCryptographicHash::hash(content, QCryptographicHash::Sha1);
+        if (previous.parsed.contains(entry.hash))
+            result.parsed.insert(entry.hash, previous.parsed.value(entry.hash));
+        else if (!result.parsed.contains(entry.hash))
+            result.parsed.insert(entry.hash, parseProfile(content, info.completeBaseName()));
+        result.files.insert(info.fileName(), entry);
+        result.dirty = true;
+    }
+    if (result.files.size() != previous.files.size())
+        result.dirty = true;
+    return result;
+}
+
+ProfileStore::ProfileStore(QObject *parent)
+    : QObject(parent), m_rescan(false)
+{
+    QByteArray envDirectory = qgetenv("QFREERDP_PROFILE_DIR");
+    if (!envDirectory.isEmpty()) {
+        m_directory = QFile::decodeName(envDirectory);
+    } else {
+        QSettings settings(QStringLiteral("qfreerdp"), QStringLiteral("qfreerdp"));
+        m_directory = settings.value(QStringLiteral("ProfileDirectory"),
+                                     QStringLiteral("/etc/qfreerdp/profiles")).toString();
+    }
+
+    m_watcher = new QFileSystemWatcher(this);
+    m_scanTimer = new QTimer(this);
+    m_scanTimer->setSingleShot(true);
+    m_scanTimer->setInterval(250);
+    m_scan = new QFutureWatcher<ProfileScan>(this);
+    m_pollTimer = new QTimer(this);
+    m_pollTimer->setInterval(s_pollInterval);
+    connect(m_watcher, SIGNAL(directoryChanged(QString)), m_scanTimer, SLOT(start()));
+    connect(m_pollTimer, &QTimer::timeout, this, &ProfileStore::startScan);
+    connect(m_scanTimer, &QTimer::timeout, this, &ProfileStore::startScan);
+    connect(m_scan, &QFutureWatcher<ProfileScan>::finished, this, &ProfileStore::scanFinished);
+
+    if (!QDir(m_directory).exists())
+        return;
+
+    // Start out with whatever we saw last time, and let the background
+    // scan pick up any differences
+    loadCache();
+    m_watcher->addPath(m_directory);
+    m_pollTimer->start();
+    startScan();
+}
+
+QStringList ProfileStore::servers() const
+{
+    QStringList result = m_profiles.keys();
+    result.sort();
+    return result;
+}
+
+QVariantMap ProfileStore::profile(const QString &server) const
+{
+    auto iter = m_profiles.constFind(server);
+    if (iter == m_profiles.constEnd())
+        return QVariantMap();
+    return m_current.parsed.value(*iter);
+}
+
+void ProfileStore::startScan()
+{
+    if (m_scan->isRunning()) {
+        m_rescan = true;
+        return;
+    }
+    m_scan->setFuture(QtConcurrent::run(scanProfiles, m_directory, m_current));
+}
+
+void ProfileStore::scanFinished()
+{
+    ProfileScan scan = m_scan->result();
+    QStringList changed = setProfiles(scan);
+    if (scan.dirty)
+        saveCache();
+
+    if (m_rescan) {
+        m_rescan = false;
+        startScan();
+    }
+    if (!changed.isEmpty())
+        emit profilesChanged(changed);
+}
+
+QStringList ProfileStore::setProfiles(const ProfileScan &scan)
+{
+    // Sort by file name so duplicate servers resolve the same way every time
+    QStringList names = scan.files.keys();
+    names.sort();
+    QHash<QString, QByteArray> profiles;
+    for (const QString &name : names) {
+        QByteArray hash = scan.files.value(name).hash;
+        profiles.insert(scan.parsed.value(hash).value(QStringLiteral("Server")).toString(), hash);
+    }
+
+    QStringList changed;
+    for (auto iter = profiles.constBegin(); iter != profiles.constEnd(); ++iter) {
+        if (m_profiles.value(iter.key()) != iter.value())
+            changed.append(iter.key());
+    }
+    for (auto iter = m_profiles.constBegin(); iter != m_profiles.constEnd(); ++iter) {
+        if (!profiles.contains(iter.key()))
+            changed.append(iter.key());
+    }
+
+    m_current = scan;
+    m_profiles = profiles;
+    return changed;
+}
+
+void ProfileStore::loadCache()
+{
+    QFile file(cachePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream stream(&file);
+    quint32 version;
+    QString directory;
+    stream >> version >> directory;
+    if (version != s_cacheVersion || directory != m_directory)
+        return;
+
+    ProfileScan scan;
+    quint32 count;
+    stream >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString name;
+        ProfileFile entry;
+        stream >> name >> entry.size >> entry.modified >> entry.hash;
+        scan.files.insert(name, entry);
+    }
+    stream >> scan.parsed;
+    if (stream.status() == QDataStream::Ok)
+        setProfiles(scan);
+}
+
+void ProfileStore::saveCache()
+{
+    QDir().mkpath(QFileInfo(cachePath()).absolutePath());
+    QSaveFile file(cachePath());
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream stream(&file);
+    stream << s_cacheVersion << m_directory;
+    stream << static_cast<quint32>(m_current.files.size());
+    for (auto iter = m_current.files.constBegin(); iter != m_current.files.constEnd(); ++iter)
+        stream << iter.key() << iter->size << iter->modified << iter->hash;
+    stream << m_current.parsed;
+    file.commit();
+}
@@ -0,0 +1,82 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _QFREERDP_PROFILES_H
+#define _QFREERDP_PROFILES_H
+
+#include <QObject>
+#include <QHash>
+#include <QVariantMap>
+#include <QFutureWatcher>
+
+class QFileSystemWatcher;
+class QTimer;
+
+struct ProfileFile
+{
+    qint64 size;
+    qint64 modified;
+    QByteArray hash;
+};
+
+struct ProfileScan
+{
+    ProfileScan() : dirty(false) { }
+
+    QHash<QString, ProfileFile> files;      // Keyed by file name
+    QHash<QByteArray, QVariantMap> parsed;  // Keyed by content hash
+    bool dirty;
+};
+
+/* Read-only connection profiles shared from a central directory.  Each
+ * *.ini file holds launcher settings for one server, using the same keys
+ * as our own QSettings file.  Parsed profiles are cached on disk by content
+ * hash, so only new or modified files need to be read at startup. */
+class ProfileStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ProfileStore(QObject *parent = Q_NULLPTR);
+
+    QStringList servers() const;
+    QVariantMap profile(const QString &server) const;
+
+signals:
+    void profilesChanged(const QStringList &servers);
+
+private slots:
+    void startScan();
+    void scanFinished();
+
+private:
+    QString m_directory;
+    QFileSystemWatcher *m_watcher;
+    QTimer *m_scanTimer;
+    QTimer *m_pollTimer;
+    QFutureWatcher<ProfileScan> *m_scan;
+    bool m_rescan;
+
+    ProfileScan m_current;
+    QHash<QString, QByteArray> m_profiles;  // Server name -> content hash
+
+    QStringList setProfiles(const ProfileScan &scan);
+    void loadCache();
+    void saveCache();
+};
+
+#endif
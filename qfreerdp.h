@@ -33,11 +33,32 @@ struct QOverload
 };
 #endif
 
+/* Accepts host, host:port, [address] and [address]:port */
+inline void splitServer(const QString &server, QString *host, quint16 *port)
+{
+    *host = server;
+    *port = 3389;
+    int colon = server.lastIndexOf(QLatin1Char(':'));
+    if (server.startsWith(QLatin1Char('['))) {
+        int bracket = server.indexOf(QLatin1Char(']'));
+        if (bracket < 0)
+            return;
+        *host = server.mid(1, bracket - 1);
+        if (colon > bracket)
+            *port = server.mid(colon + 1).toUShort();
+    } else if (colon >= 0 && server.indexOf(QLatin1Char(':')) == colon) {
+        *host = server.left(colon);
+        *port = server.mid(colon + 1).toUShort();
+    }
+    if (*port == 0)
+        *port = 3389;
+}
+
 template <typename... Args>
-QPair<QByteArray, bool> queryXFreeRDP(const Args&... queryParams)
+QPair<QByteArray, bool> queryXFreeRDP(const QString &program, const Args&... queryParams)
 {
     QProcess proc;
-    proc.start(QStringLiteral("xfreerdp"), QStringList { queryParams... });
+    proc.start(program, QStringList { queryParams... });
     if (!proc.waitForStarted())
         return qMakePair(QByteArray{}, false);
     proc.waitForFinished();
@@ -0,0 +1,170 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "relay.h"
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+/* Roughly one packet per segment, so loss and bandwidth apply at a
+ * realistic granularity.  Past the queue limit we stop reading from the
+ * sender and let TCP flow control push back on it. */
+static const int s_segmentSize = 1400;
+static const qint64 s_maxQueued = 4 * 1024 * 1024;
+
+RelayPipe::RelayPipe(QTcpSocket *source, QTcpSocket *sink, const LinkConditions &conditions,
+                     const QElapsedTimer &clock, QObject *parent)
+    : QObject(parent), m_source(source), m_sink(sink), m_conditions(conditions),
+      m_clock(clock), m_random(static_cast<quint32>(clock.nsecsElapsed())),
+      m_queued(0), m_linkFree(0), m_lastRelease(0), m_bytes(0), m_sourceClosed(false)
+{
+    m_timer = new QTimer(this);
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, &QTimer::timeout, this, &RelayPipe::deliver);
+
+    m_source->setReadBufferSize(64 * 1024);
+    connect(m_source, &QTcpSocket::readyRead, this, &RelayPipe::readSource);
+    connect(m_source, &QTcpSocket::disconnected, [this]()
+    {
+        m_sourceClosed = true;
+        readSource();
+    });
+}
+
+qint64 RelayPipe::releaseTime(int size)
+{
+    // All times are in microseconds on the relay's clock
+    qint64 now = m_clock.nsecsElapsed() / 1000;
+    qint64 release = now;
+    if (m_conditions.bandwidthKbps > 0) {
+        release = qMax(now, m_linkFree)
+                + static_cast<qint64>(size) * 8 * 1000 / m_conditions.bandwidthKbps;
+        m_linkFree = release;
+    }
+    release += m_conditions.latencyMsecs * 1000;
+    if (m_conditions.jitterMsecs > 0) {
+        std::uniform_int_distribution<int> jitter(0, m_conditions.jitterMsecs * 1000);
+        release += jitter(m_random);
+    }
+    if (m_conditions.lossPercent > 0) {
+        // TCP hides the loss itself, but the sender has to wait for the
+        // retransmission timeout before the data gets through
+        std::uniform_real_distribution<double> chance(0, 100);
+        if (chance(m_random) < m_conditions.lossPercent)
+            release += qMax(200, 2 * m_conditions.latencyMsecs) * 1000;
+    }
+    if (m_conditions.stallInterval > 0) {
+        qint64 cycle = static_cast<qint64>(m_conditions.stallInterval) * 1000000;
+        qint64 offset = release % cycle;
+        if (offset < m_conditions.stallMsecs * 1000)
+            release += m_conditions.stallMsecs * 1000 - offset;
+    }
+
+    // A TCP stream can't overtake itself
+    release = qMax(release, m_lastRelease);
+    m_lastRelease = release;
+    return release;
+}
+
+void RelayPipe::readSource()
+{
+    while (m_queued < s_maxQueued && m_source->bytesAvailable() > 0) {
+        Segment segment;
+        segment.data = m_source->read(s_segmentSize);
+        segment.release = releaseTime(segment.data.size());
+        m_queued += segment.data.size();
+        m_queue.enqueue(segment);
+    }
+
+    if (!m_timer->isActive())
+        deliver();
+}
+
+void RelayPipe::deliver()
+{
+    qint64 now = m_clock.nsecsElapsed() / 1000;
+    while (!m_queue.isEmpty() && m_queue.head().release <= now) {
+        Segment segment = m_queue.dequeue();
+        m_queued -= segment.data.size();
+        m_bytes += segment.data.size();
+        m_sink->write(segment.data);
+    }
+
+    if (!m_queue.isEmpty()) {
+        m_timer->start(static_cast<int>((m_queue.head().release - now + 999) / 1000));
+    } else if (m_sourceClosed && m_source->bytesAvailable() == 0) {
+        m_sink->disconnectFromHost();
+        return;
+    }
+
+    // Pick up anything we left unread while the queue was full
+    if (m_queued < s_maxQueued && m_source->bytesAvailable() > 0)
+        readSource();
+}
+
+NetworkRelay::NetworkRelay(const QString &host, quint16 port,
+                           const LinkConditions &conditions, QObject *parent)
+    : QObject(parent), m_host(host), m_port(port), m_conditions(conditions)
+{
+    m_server = new QTcpServer(this);
+    connect(m_server, &QTcpServer::newConnection, this, &NetworkRelay::acceptConnection);
+    m_clock.start();
+}
+
+bool NetworkRelay::listen()
+{
+    return m_server->listen(QHostAddress::LocalHost, 0);
+}
+
+quint16 NetworkRelay::localPort() const
+{
+    return m_server->serverPort();
+}
+
+qint64 NetworkRelay::bytesToServer() const
+{
+    qint64 total = 0;
+    for (RelayPipe *pipe : m_toServer)
+        total += pipe->bytes();
+    return total;
+}
+
+qint64 NetworkRelay::bytesToClient() const
+{
+    qint64 total = 0;
+    for (RelayPipe *pipe : m_toClient)
+        total += pipe->bytes();
+    return total;
+}
+
+void NetworkRelay::acceptConnection()
+{
+    while (QTcpSocket *client = m_server->nextPendingConnection()) {
+        QTcpSocket *server = new QTcpSocket(this);
+        client->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        server->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        m_toServer.append(new RelayPipe(client, server, m_conditions, m_clock, this));
+        m_toClient.append(new RelayPipe(server, client, m_conditions, m_clock, this));
+
+        // If the real server can't be reached, don't leave the client hanging
+        connect(server, SIGNAL(error(QAbstractSocket::SocketError)),
+                client, SLOT(disconnectFromHost()));
+        server->connectToHost(m_host, m_port);
+    }
+}
@@ -0,0 +1,112 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _QFREERDP_RELAY_H
+#define _QFREERDP_RELAY_H
+
+#include <QObject>
+#include <QQueue>
+#include <QElapsedTimer>
+#include <random>
+
+class QTcpServer;
+class QTcpSocket;
+class QTimer;
+
+struct LinkConditions
+{
+    LinkConditions()
+        : latencyMsecs(0), jitterMsecs(0), bandwidthKbps(0), lossPercent(0),
+          stallInterval(0), stallMsecs(0) { }
+
+    int latencyMsecs;       // One way
+    int jitterMsecs;
+    int bandwidthKbps;      // 0 for unlimited
+    double lossPercent;
+    int stallInterval;      // Seconds between stalls, 0 to disable
+    int stallMsecs;
+};
+
+/* One direction of a relayed connection.  Data is held back until the
+ * emulated link would have delivered it, then written to the sink. */
+class RelayPipe : public QObject
+{
+    Q_OBJECT
+
+public:
+    RelayPipe(QTcpSocket *source, QTcpSocket *sink, const LinkConditions &conditions,
+              const QElapsedTimer &clock, QObject *parent);
+
+    qint64 bytes() const { return m_bytes; }
+
+private slots:
+    void readSource();
+    void deliver();
+
+private:
+    struct Segment
+    {
+        qint64 release;
+        QByteArray data;
+    };
+
+    QTcpSocket *m_source;
+    QTcpSocket *m_sink;
+    LinkConditions m_conditions;
+    const QElapsedTimer &m_clock;
+    std::minstd_rand m_random;
+    QTimer *m_timer;
+    QQueue<Segment> m_queue;
+    qint64 m_queued;
+    qint64 m_linkFree;
+    qint64 m_lastRelease;
+    qint64 m_bytes;
+    bool m_sourceClosed;
+
+    qint64 releaseTime(int size);
+};
+
+/* Local TCP relay which forwards to the real server through an emulated
+ * WAN link, so presets can be compared under reproducible conditions */
+class NetworkRelay : public QObject
+{
+    Q_OBJECT
+
+public:
+    NetworkRelay(const QString &host, quint16 port, const LinkConditions &conditions,
+                 QObject *parent = Q_NULLPTR);
+
+    bool listen();
+    quint16 localPort() const;
+
+    qint64 bytesToServer() const;
+    qint64 bytesToClient() const;
+
+private slots:
+    void acceptConnection();
+
+private:
+    QString m_host;
+    quint16 m_port;
+    LinkConditions m_conditions;
+    QTcpServer *m_server;
+    QElapsedTimer m_clock;
+    QList<RelayPipe *> m_toServer;
+    QList<RelayPipe *> m_toClient;
+};
+
+#endif
@@ -0,0 +1,275 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "replay.h"
+
+#include "client.h"
+#include "params.h"
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QSettings>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cstdio>
+
+/* Recording with /pcap: makes the client ask for RemoteFX only, and only
+ * RemoteFX surface data ends up in the file.  Playback therefore never
+ * touches the bitmap, offscreen or glyph caches, and the bit depth, which
+ * decides the format every tile is converted to, is what's left to vary. */
+static const int s_replayDepths[] = { 16, 24, 32 };
+
+/* Replays are drawn on an Xvfb screen this size */
+static const QSize s_replayScreen(1920, 1080);
+
+/* Give up on a replay which takes this long; it's probably waiting on
+ * something which will never come */
+static const int s_replayTimeout = 10 * 60 * 1000;
+
+QString captureFileName(const QString &server)
+{
+    QDir captureDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+                    + QStringLiteral("/captures"));
+    // The client writes the capture with its own umask, so the directory
+    // is what keeps the screen contents from other users
+    captureDir.mkpath(QStringLiteral("."));
+    QFile::setPermissions(captureDir.path(),
+                          QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner);
+
+    static const QRegularExpression re_unsafe("[^A-Za-z0-9._-]");
+    return captureDir.filePath(QStringLiteral("%1-%2.pcap")
+            .arg(QString(server).replace(re_unsafe, QStringLiteral("_")))
+            .arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-HHmmss"))));
+}
+
+/* High water mark of the process' resident set, in KiB */
+static qint64 peakRss(qint64 pid)
+{
+    QFile status(QStringLiteral("/proc/%1/status").arg(pid));
+    if (!status.open(QIODevice::ReadOnly))
+        return 0;
+    for (QByteArray line : status.readAll().split('\n')) {
+        if (line.startsWith("VmHWM:"))
+            return line.mid(6).trimmed().split(' ').first().toLongLong();
+    }
+    return 0;
+}
+
+static bool startXvfb(QProcess &xvfb, QString *display)
+{
+    // Let Xvfb pick a free display and tell us which one it got
+    xvfb.setProcessChannelMode(QProcess::SeparateChannels);
+    xvfb.start(QStringLiteral("Xvfb"), QStringList {
+                   QStringLiteral("-displayfd"), QStringLiteral("1"),
+                   QStringLiteral("-screen"), QStringLiteral("0"),
+                   QStringLiteral("%1x%2x24").arg(s_replayScreen.width())
+                                             .arg(s_replayScreen.height()),
+                   QStringLiteral("-nolisten"), QStringLiteral("tcp") });
+    if (!xvfb.waitForStarted())
+        return false;
+    while (!xvfb.canReadLine()) {
+        if (!xvfb.waitForReadyRead(10000))
+            return false;
+    }
+    *display = QLatin1Char(':') + QString::fromLatin1(xvfb.readLine().trimmed());
+    return true;
+}
+
+static void stopXvfb(QProcess &xvfb)
+{
+    xvfb.terminate();
+    if (!xvfb.waitForFinished(5000)) {
+        xvfb.kill();
+        xvfb.waitForFinished();
+    }
+}
+
+/* The user's saved settings, minus anything which needs a server */
+static ConnectionSettings replaySettings()
+{
+    QSettings settings(QStringLiteral("qfreerdp"), QStringLiteral("qfreerdp"));
+    ConnectionSettings connection = readConnectionSettings(
+            [&settings](const QString &key, const QVariant &defaultValue)
+    {
+        return settings.value(key, defaultValue);
+    });
+    connection.gateway.clear();
+    connection.gatewayUsername.clear();
+    if (connection.resolutionType == RT_RemoteApp)
+        connection.resolutionType = RT_Fullscreen;
+    if (connection.resolutionType == RT_Standard && !connection.standardSize.isValid())
+        connection.standardSize = s_replayScreen;
+    return connection;
+}
+
+static QStringList replayParams(const ConnectionSettings &connection,
+                                const QString &capture, int major)
+{
+    ClientOptions options(major);
+    options.add(CO_PlayRfx, capture);
+    return options.params() + clientParams(connection, major);
+}
+
+struct ReplayResult
+{
+    ReplayResult() : wallMsecs(0), cpuMsecs(0), peakKiB(0) { }
+
+    double wallMsecs;   // Median
+    double cpuMsecs;    // Mean
+    qint64 peakKiB;
+};
+
+/* Returns false if any of the runs failed */
+static bool replayRuns(const QString &program, const QStringList &params,
+                       const QProcessEnvironment &env, int runs, ReplayResult *result)
+{
+    QList<qint64> wall;
+    qint64 peak = 0;
+    double cpuBefore = childCpuMsecs();
+    for (int i = 0; i < runs; ++i) {
+        QProcess process;
+        process.setProcessEnvironment(env);
+        process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        process.setStandardOutputFile(QProcess::nullDevice());
+
+        QElapsedTimer timer;
+        timer.start();
+        process.start(program, params);
+        if (!process.waitForStarted())
+            return false;
+
+        // VmHWM is gone once the process is reaped, so keep sampling it
+        // until then
+        qint64 pid = process.processId();
+        while (!process.waitForFinished(20)) {
+            peak = qMax(peak, peakRss(pid));
+            if (timer.elapsed() > s_replayTimeout) {
+                process.kill();
+                process.waitForFinished();
+                return false;
+            }
+        }
+        if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0)
+            return false;
+        wall.append(timer.nsecsElapsed());
+    }
+
+    std::sort(wall.begin(), wall.end());
+    result->wallMsecs = wall[wall.size() / 2] / 1e6;
+    result->cpuMsecs = (childCpuMsecs() - cpuBefore) / runs;
+    result->peakKiB = peak;
+    return true;
+}
+
+int replayBenchmark(const QString &capture, int runs)
+{
+    if (!QFileInfo(capture).isReadable()) {
+        fprintf(stderr, "Cannot read capture %s\n", capture.toLocal8Bit().constData());
+        return 1;
+    }
+
+    ClientInfo client;
+    if (!probeClient(defaultClient(), &client)) {
+        fprintf(stderr, "Error starting %s.  Is it in your PATH?\n",
+                client.program.toLocal8Bit().constData());
+        return 2;
+    }
+
+    QProcess xvfb;
+    QString display;
+    if (!startXvfb(xvfb, &display)) {
+        fputs("Could not start Xvfb.  Is it in your PATH?\n", stderr);
+        xvfb.kill();
+        xvfb.waitForFinished();
+        return 2;
+    }
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    env.insert(QStringLiteral("DISPLAY"), display);
+
+    printf("%s %s on %s\n", client.program.toLocal8Bit().constData(),
+           client.version.isEmpty() ? "?" : client.version.toLocal8Bit().constData(),
+           display.toLocal8Bit().constData());
+    // Everything else as the user last connected
+    ConnectionSettings connection = replaySettings();
+    printf("%-16s %12s %12s %12s\n", "settings", "median ms", "cpu ms", "peak MiB");
+    for (int bpp : s_replayDepths) {
+        connection.bpp = bpp;
+        QByteArray name = QStringLiteral("%1bpp").arg(bpp).toLatin1();
+        ReplayResult result;
+        if (!replayRuns(client.program, replayParams(connection, capture, client.major),
+                        env, runs, &result)) {
+            printf("%-16s %12s %12s %12s\n", name.constData(), "failed", "-", "-");
+            continue;
+        }
+        printf("%-16s %12.2f %12.2f %12.1f\n", name.constData(), result.wallMsecs,
+               result.cpuMsecs, result.peakKiB / 1024.0);
+    }
+
+    stopXvfb(xvfb);
+    return 0;
+}
+
+int compareClients(const QString &capture, int runs)
+{
+    if (!QFileInfo(capture).isReadable()) {
+        fprintf(stderr, "Cannot read capture %s\n", capture.toLocal8Bit().constData());
+        return 1;
+    }
+    QStringList clients = availableClients();
+    if (clients.isEmpty()) {
+        fputs("No FreeRDP clients found in PATH\n", stderr);
+        return 2;
+    }
+
+    QProcess xvfb;
+    QString display;
+    if (!startXvfb(xvfb, &display)) {
+        fputs("Could not start Xvfb.  Is it in your PATH?\n", stderr);
+        xvfb.kill();
+        xvfb.waitForFinished();
+        return 2;
+    }
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    env.insert(QStringLiteral("DISPLAY"), display);
+
+    // Every client gets the same settings, each in its own syntax
+    const ConnectionSettings connection = replaySettings();
+    printf("%-16s %-10s %12s %12s %12s\n", "client", "version", "median ms", "cpu ms",
+           "peak MiB");
+    for (const QString &program : clients) {
+        ClientInfo info;
+        ReplayResult result;
+        if (!probeClient(program, &info) || (info.major != 2 && info.major != 3)
+                || !replayRuns(program, replayParams(connection, capture, info.major),
+                               env, runs, &result)) {
+            printf("%-16s %-10s %12s %12s %12s\n", program.toLocal8Bit().constData(),
+                   info.version.isEmpty() ? "?" : info.version.toLocal8Bit().constData(),
+                   "failed", "-", "-");
+            continue;
+        }
+        printf("%-16s %-10s %12.2f %12.2f %12.1f\n", program.toLocal8Bit().constData(),
+               info.version.toLocal8Bit().constData(), result.wallMsecs, result.cpuMsecs,
+               result.peakKiB / 1024.0);
+    }
+
+    stopXvfb(xvfb);
+    return 0;
+}
@@ -0,0 +1,35 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _QFREERDP_REPLAY_H
+#define _QFREERDP_REPLAY_H
+
+#include <QString>
+
+/* A new file to record a session with the given server into */
+QString captureFileName(const QString &server);
+
+/* Plays a recorded session back into the default client under Xvfb with
+ * the saved settings, once for each bit depth, and prints the CPU time,
+ * peak memory and wall time each one took.  No server is needed. */
+int replayBenchmark(const QString &capture, int runs);
+
+/* Plays a recorded session back into each available client with the same
+ * saved settings, so the clients can be compared on equal terms */
+int compareClients(const QString &capture, int runs);
+
+#endif
@@ -0,0 +1,192 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "resident.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QSocketNotifier>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static void residentSocketPath(char *buffer, size_t size)
+{
+    const char *runtimeDir = getenv("XDG_RUNTIME_DIR");
+    if (runtimeDir && runtimeDir[0])
+        snprintf(buffer, size, "%s/qfreerdp.sock", runtimeDir);
+    else
+        snprintf(buffer, size, "/tmp/qfreerdp-%u.sock", static_cast<unsigned>(getuid()));
+}
+
+bool forwardToResident(const char *request)
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    residentSocketPath(addr.sun_path, sizeof(addr.sun_path));
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+    if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        return false;
+    }
+
+    // Don't hang forever on a resident instance that stopped responding
+    timeval timeout { 2, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    // If the resident instance goes away mid-request, fail rather than
+    // dying from SIGPIPE
+    size_t length = strlen(request);
+    bool ok = send(fd, request, length, MSG_NOSIGNAL) == static_cast<ssize_t>(length)
+              && send(fd, "\n", 1, MSG_NOSIGNAL) == 1;
+    char reply[3];
+    if (ok)
+        ok = read(fd, reply, sizeof(reply)) == sizeof(reply) && memcmp(reply, "ok\n", 3) == 0;
+    close(fd);
+    return ok;
+}
+
+ResidentServer::ResidentServer(QObject *parent)
+    : QObject(parent)
+{
+    m_server = new QLocalServer(this);
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+    connect(m_server, &QLocalServer::newConnection,
+            this, &ResidentServer::acceptConnection);
+}
+
+bool ResidentServer::listen()
+{
+    char path[sizeof(sockaddr_un::sun_path)];
+    residentSocketPath(path, sizeof(path));
+    QString name = QString::fromLocal8Bit(path);
+    if (!m_server->listen(name)) {
+        // A crashed resident instance may have left its socket behind.
+        // Only take it over if nobody is answering on it.
+        if (m_server->serverError() != QAbstractSocket::AddressInUseError
+                || forwardToResident("ping"))
+            return false;
+        QLocalServer::removeServer(name);
+        if (!m_server->listen(name))
+            return false;
+    }
+
+    SignalNotifier *notifier = new SignalNotifier(this);
+    connect(notifier, &SignalNotifier::raised, this, &ResidentServer::handleSignal);
+    notifier->watch(SIGTERM);
+    notifier->watch(SIGINT);
+    notifier->watch(SIGUSR1);
+    return true;
+}
+
+void ResidentServer::handleSignal(int signal)
+{
+    if (signal == SIGUSR1)
+        emit dumpLogsRequested();
+    else
+        emit quitRequested();
+}
+
+/* The handlers pass the signal on to the event loop through a socket */
+static int s_signalSockets[2] = { -1, -1 };
+
+static void forwardSignal(int signal)
+{
+    char byte = static_cast<char>(signal);
+    ssize_t written = write(s_signalSockets[1], &byte, 1);
+    (void)written;
+}
+
+SignalNotifier::SignalNotifier(QObject *parent)
+    : QObject(parent)
+{
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, s_signalSockets) < 0)
+        return;
+    QSocketNotifier *notifier = new QSocketNotifier(s_signalSockets[0],
+                                                    QSocketNotifier::Read, this);
+    connect(notifier, SIGNAL(activated(int)), this, SLOT(readSignal()));
+}
+
+SignalNotifier::~SignalNotifier()
+{
+    for (int watched : m_signals)
+        signal(watched, SIG_DFL);
+    if (s_signalSockets[0] < 0)
+        return;
+    close(s_signalSockets[0]);
+    close(s_signalSockets[1]);
+    s_signalSockets[0] = s_signalSockets[1] = -1;
+}
+
+bool SignalNotifier::watch(int signal)
+{
+    if (s_signalSockets[0] < 0)
+        return false;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = forwardSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    if (sigaction(signal, &action, Q_NULLPTR) < 0)
+        return false;
+    m_signals.append(signal);
+    return true;
+}
+
+void SignalNotifier::readSignal()
+{
+    char byte;
+    if (read(s_signalSockets[0], &byte, 1) == 1)
+        emit raised(byte);
+}
+
+void ResidentServer::acceptConnection()
+{
+    while (QLocalSocket *client = m_server->nextPendingConnection()) {
+        connect(client, &QLocalSocket::disconnected, client, &QObject::deleteLater);
+        connect(client, &QLocalSocket::readyRead, [this, client]()
+        {
+            while (client->canReadLine()) {
+                QByteArray request = client->readLine().trimmed();
+                if (request == "ping") {
+                    client->write("ok\n");
+                } else if (request == "show") {
+                    // Reply first so the forwarding process can exit while
+                    // we are still building the dialog
+                    client->write("ok\n");
+                    client->flush();
+                    emit showRequested();
+                } else if (request == "dump-logs") {
+                    client->write("ok\n");
+                    emit dumpLogsRequested();
+                } else {
+                    client->write("error\n");
+                }
+            }
+        });
+    }
+}
@@ -0,0 +1,79 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _QFREERDP_RESIDENT_H
+#define _QFREERDP_RESIDENT_H
+
+#include <QObject>
+#include <QList>
+
+class QLocalServer;
+
+/* Sends a single-line request to a running resident instance.  This is
+ * deliberately implemented without Qt so that it can be called before the
+ * QApplication is constructed, which is where most of our startup time goes.
+ * Returns false if there is no resident instance to talk to. */
+bool forwardToResident(const char *request);
+
+/* Turns Unix signals into a Qt signal, since signal handlers may only do
+ * very little.  Only one may exist at a time. */
+class SignalNotifier : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SignalNotifier(QObject *parent = Q_NULLPTR);
+    ~SignalNotifier();
+
+    bool watch(int signal);
+
+signals:
+    void raised(int signal);
+
+private slots:
+    void readSignal();
+
+private:
+    QList<int> m_signals;
+};
+
+class ResidentServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ResidentServer(QObject *parent = Q_NULLPTR);
+
+    /* Also turns SIGTERM and SIGINT into quitRequested(), so a resident
+     * instance goes through the normal exit path, and SIGUSR1 into
+     * dumpLogsRequested() */
+    bool listen();
+
+signals:
+    void showRequested();
+    void dumpLogsRequested();
+    void quitRequested();
+
+private slots:
+    void acceptConnection();
+    void handleSignal(int signal);
+
+private:
+    QLocalServer *m_server;
+};
+
+#endif
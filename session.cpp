@@ -0,0 +1,252 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "session.h"
+
+#include "qfreerdp.h"
+#include "history.h"
+#include "relay.h"
+#include "trace.h"
+#include <QDateTime>
+#include <QDir>
+#include <QEventLoopLocker>
+#include <QFile>
+#include <QRegularExpression>
+#include <QStandardPaths>
+#include <cstdio>
+#include <cstring>
+#include <zlib.h>
+
+/* Per-session in-memory log size, and the cap for all flushed segments */
+static const int s_logBufferSize = 256 * 1024;
+static const qint64 s_logDiskLimit = 16 * 1024 * 1024;
+
+static QList<Session *> s_sessions;
+
+/* Logged by FreeRDP's GDI once the connection is up and the first frame
+ * is about to be drawn, which is the closest we get to "connected" */
+static const QByteArray s_connectedMarker("Local framebuffer format");
+
+RingBuffer::RingBuffer(int capacity)
+    : m_start(0), m_size(0)
+{
+    m_data.resize(capacity);
+}
+
+void RingBuffer::append(const char *data, int size)
+{
+    const int capacity = m_data.size();
+    if (size >= capacity) {
+        // Only the tail of this chunk can survive anyway
+        memcpy(m_data.data(), data + size - capacity, capacity);
+        m_start = 0;
+        m_size = capacity;
+        return;
+    }
+
+    int end = (m_start + m_size) % capacity;
+    int first = qMin(size, capacity - end);
+    memcpy(m_data.data() + end, data, first);
+    memcpy(m_data.data(), data + first, size - first);
+    m_size += size;
+    if (m_size > capacity) {
+        m_start = (m_start + m_size - capacity) % capacity;
+        m_size = capacity;
+    }
+}
+
+QByteArray RingBuffer::take()
+{
+    QByteArray result;
+    result.reserve(m_size);
+    int first = qMin(m_size, m_data.size() - m_start);
+    result.append(m_data.constData() + m_start, first);
+    result.append(m_data.constData(), m_size - first);
+    m_start = 0;
+    m_size = 0;
+    return result;
+}
+
+static QString logDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+            + QStringLiteral("/logs");
+}
+
+static void pruneLogs(const QDir &logDir)
+{
+    // Newest first, so we drop the oldest segments once we go over the cap
+    qint64 total = 0;
+    for (const QFileInfo &info : logDir.entryInfoList(QStringList { QStringLiteral("*.log.gz") },
+                                                      QDir::Files, QDir::Time)) {
+        total += info.size();
+        if (total > s_logDiskLimit)
+            QFile::remove(info.absoluteFilePath());
+    }
+}
+
+Session::Session(const QString &server, bool captureLogs, QObject *parent)
+    : QObject(parent), m_server(server), m_logSegment(0), m_supervised(false), m_settingsKey(0),
+      m_connectMsecs(-1), m_pid(0), m_relay(Q_NULLPTR)
+{
+    m_process = new QProcess(this);
+    if (captureLogs)
+        m_log.reset(new RingBuffer(s_logBufferSize));
+    connect(m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, &Session::processFinished);
+}
+
+Session::~Session()
+{
+    s_sessions.removeOne(this);
+}
+
+bool Session::start(const QString &program, const QStringList &params)
+{
+    TRACE_SCOPE("Session::start");
+    if (isDetached()) {
+        // The client then survives the launcher, and its terminal closing
+        if (!QProcess::startDetached(program, params))
+            return false;
+        deleteLater();
+        return true;
+    }
+
+    // FreeRDP logs the connect marker to stdout, so we always read that
+    // and pass it on when not capturing
+    m_process->setProcessChannelMode(m_log ? QProcess::MergedChannels
+                                           : QProcess::ForwardedErrorChannel);
+    connect(m_process, &QProcess::readyRead, this, &Session::readOutput);
+
+    // xfreerdp may still need to ask the user about certificates
+    m_process->setInputChannelMode(QProcess::ForwardedInputChannel);
+
+    m_process->start(program, params);
+    if (!m_process->waitForStarted())
+        return false;
+
+    // Keep the application alive until the session ends, even after the
+    // launcher dialog is closed
+    m_quitLock.reset(new QEventLoopLocker);
+    s_sessions.append(this);
+    m_pid = m_process->processId();
+    m_startTime = QDateTime::currentDateTime();
+    m_elapsed.start();
+    return true;
+}
+
+bool Session::flushLog()
+{
+    if (!m_log)
+        return false;
+    QByteArray data = m_log->take();
+    if (data.isEmpty())
+        return true;
+
+    // The output may include user names, hosts and file paths
+    QDir logDir(logDirectory());
+    if (!logDir.mkpath(QStringLiteral(".")))
+        return false;
+    QFile::setPermissions(logDir.path(), QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner);
+
+    static const QRegularExpression re_unsafe("[^A-Za-z0-9._-]");
+    QString fileName = QStringLiteral("%1-%2-%3-%4.log.gz")
+            .arg(QString(m_server).replace(re_unsafe, QStringLiteral("_")))
+            .arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-HHmmss")))
+            .arg(m_pid)
+            .arg(m_logSegment++);
+    QByteArray path = QFile::encodeName(logDir.filePath(fileName));
+    gzFile gz = gzopen(path.constData(), "wb");
+    if (!gz)
+        return false;
+    bool ok = gzwrite(gz, data.constData(), data.size()) == data.size();
+    ok = (gzclose(gz) == Z_OK) && ok;
+
+    pruneLogs(logDir);
+    return ok;
+}
+
+void Session::setRelay(NetworkRelay *relay)
+{
+    relay->setParent(this);
+    m_relay = relay;
+}
+
+bool Session::isAbnormalExit(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    // xfreerdp uses codes below 128 for the various reasons a session can
+    // end normally (logoff, disconnect by an administrator, idle timeout...)
+    // with the exception of running out of memory.  128 and above are
+    // argument, connection and authentication failures.
+    return exitStatus == QProcess::CrashExit || exitCode == 6 || exitCode >= 128;
+}
+
+void Session::flushAllLogs()
+{
+    for (Session *session : s_sessions)
+        session->flushLog();
+}
+
+void Session::readOutput()
+{
+    char buffer[4096];
+    qint64 length;
+    while ((length = m_process->read(buffer, sizeof(buffer))) > 0) {
+        if (m_log) {
+            m_log->append(buffer, static_cast<int>(length));
+        } else {
+            fwrite(buffer, 1, static_cast<size_t>(length), stdout);
+            fflush(stdout);
+        }
+        if (m_connectMsecs >= 0)
+            continue;
+
+        // Keep enough of the previous chunk to spot a marker split over two
+        m_outputTail.append(buffer, static_cast<int>(length));
+        if (m_outputTail.contains(s_connectedMarker)) {
+            m_connectMsecs = static_cast<qint32>(m_elapsed.elapsed());
+            m_outputTail.clear();
+        } else {
+            m_outputTail = m_outputTail.right(s_connectedMarker.size() - 1);
+        }
+    }
+}
+
+void Session::processFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    bool abnormal = isAbnormalExit(exitCode, exitStatus);
+    readOutput();
+    if (m_log && abnormal)
+        flushLog();
+
+    SessionRecord record;
+    record.server = m_server;
+    record.started = m_startTime.toMSecsSinceEpoch() / 1000;
+    record.connectMsecs = m_connectMsecs;
+    record.duration = static_cast<qint32>(m_elapsed.elapsed() / 1000);
+    record.abnormal = abnormal;
+    // Traffic is only known when it went through our relay
+    record.bytesSent = m_relay ? m_relay->bytesToServer() : -1;
+    record.bytesReceived = m_relay ? m_relay->bytesToClient() : -1;
+    record.settings = m_settingsKey;
+    appendSessionRecord(record);
+
+    s_sessions.removeOne(this);
+    emit finished();
+    m_quitLock.reset();
+    deleteLater();
+}
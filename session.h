@@ -0,0 +1,98 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _QFREERDP_SESSION_H
+#define _QFREERDP_SESSION_H
+
+#include <QObject>
+#include <QProcess>
+#include <QScopedPointer>
+#include <QDateTime>
+#include <QElapsedTimer>
+
+class QEventLoopLocker;
+class NetworkRelay;
+
+/* Fixed-size byte buffer which keeps only the most recent data written */
+class RingBuffer
+{
+public:
+    explicit RingBuffer(int capacity);
+
+    void append(const char *data, int size);
+    QByteArray take();
+
+private:
+    QByteArray m_data;
+    int m_start;
+    int m_size;
+};
+
+class Session : public QObject
+{
+    Q_OBJECT
+
+public:
+    Session(const QString &server, bool captureLogs, QObject *parent = Q_NULLPTR);
+    ~Session();
+
+    /* Unless asked to supervise, or there is log capture or a relay to
+     * run, the client is started detached so the launcher can exit, and
+     * the session object deletes itself.  Such sessions are not recorded
+     * in the history. */
+    bool isDetached() const { return !m_supervised && !m_log && !m_relay; }
+    void setSupervised(bool supervised) { m_supervised = supervised; }
+    bool start(const QString &program, const QStringList &params);
+    bool flushLog();
+
+    QString server() const { return m_server; }
+
+    /* Recorded in the per-server history when the session ends */
+    void setSettingsKey(quint32 key) { m_settingsKey = key; }
+
+    /* Takes ownership of the relay, and reports its traffic at the end */
+    void setRelay(NetworkRelay *relay);
+
+    static bool isAbnormalExit(int exitCode, QProcess::ExitStatus exitStatus);
+
+    static void flushAllLogs();
+
+signals:
+    void finished();
+
+private slots:
+    void readOutput();
+    void processFinished(int exitCode, QProcess::ExitStatus exitStatus);
+
+private:
+    QString m_server;
+    QProcess *m_process;
+    QScopedPointer<RingBuffer> m_log;
+    QScopedPointer<QEventLoopLocker> m_quitLock;
+    int m_logSegment;
+    bool m_supervised;
+
+    quint32 m_settingsKey;
+    QDateTime m_startTime;
+    QElapsedTimer m_elapsed;
+    qint32 m_connectMsecs;
+    qint64 m_pid;               // QProcess forgets it once the client exits
+    QByteArray m_outputTail;
+    NetworkRelay *m_relay;
+};
+
+#endif
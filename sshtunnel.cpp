@@ -0,0 +1,200 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "sshtunnel.h"
+
+#include <QDir>
+#include <QProcess>
+#include <QTcpServer>
+#include <QTimer>
+#include <unistd.h>
+
+static QString sshProgram()
+{
+    QString program = QString::fromLocal8Bit(qgetenv("QFREERDP_SSH"));
+    return program.isEmpty() ? QStringLiteral("ssh") : program;
+}
+
+/* ssh expands %C to a hash of the connection parameters, giving us one
+ * control socket per jump host */
+static QString controlPathOption()
+{
+    QString runtimeDir = QString::fromLocal8Bit(qgetenv("XDG_RUNTIME_DIR"));
+    if (runtimeDir.isEmpty())
+        runtimeDir = QDir::tempPath();
+    return QStringLiteral("ControlPath=%1/qfreerdp-ssh-%2-%C")
+            .arg(runtimeDir).arg(getuid());
+}
+
+SshTunnel::SshTunnel(const QString &jumpHost, const QString &host, quint16 port,
+                     QObject *parent)
+    : QObject(parent), m_jumpHost(jumpHost), m_host(host), m_port(port),
+      m_localPort(0), m_forwarding(false), m_step(ST_Idle), m_ssh(Q_NULLPTR)
+{
+    m_timeout = new QTimer(this);
+    m_timeout->setSingleShot(true);
+    connect(m_timeout, SIGNAL(timeout()), this, SLOT(stepTimedOut()));
+}
+
+SshTunnel::~SshTunnel()
+{
+    stopStep();
+
+    // Whoever destroys us shouldn't have to wait for ssh
+    if (m_forwarding) {
+        QProcess::startDetached(sshProgram(),
+                                sshArgs(QStringList { QStringLiteral("-O"),
+                                                      QStringLiteral("cancel"),
+                                                      QStringLiteral("-L"), forwardSpec() }));
+    }
+}
+
+QString SshTunnel::forwardSpec() const
+{
+    // Bracket the target so IPv6 addresses survive ssh's parsing
+    return QStringLiteral("127.0.0.1:%1:[%2]:%3").arg(m_localPort).arg(m_host).arg(m_port);
+}
+
+QStringList SshTunnel::sshArgs(const QStringList &args) const
+{
+    // Fail rather than prompt for anything, since there is nobody to answer
+    return QStringList { QStringLiteral("-o"), controlPathOption(),
+                         QStringLiteral("-o"), QStringLiteral("BatchMode=yes") }
+            + args + QStringList { m_jumpHost };
+}
+
+void SshTunnel::open()
+{
+    // Reuse the master connection if there is one, otherwise set one up
+    // which outlives this tunnel so the next session can reuse it too
+    runStep(ST_Check, QStringList { QStringLiteral("-O"), QStringLiteral("check") }, 5000);
+}
+
+void SshTunnel::runStep(Step step, const QStringList &args, int timeout)
+{
+    m_step = step;
+    m_ssh = new QProcess(this);
+    m_ssh->setStandardOutputFile(QProcess::nullDevice());
+    m_ssh->setStandardInputFile(QProcess::nullDevice());
+    connect(m_ssh, SIGNAL(finished(int,QProcess::ExitStatus)),
+            this, SLOT(stepFinished(int,QProcess::ExitStatus)));
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 6, 0))
+    connect(m_ssh, SIGNAL(errorOccurred(QProcess::ProcessError)),
+            this, SLOT(stepError(QProcess::ProcessError)));
+#else
+    connect(m_ssh, SIGNAL(error(QProcess::ProcessError)),
+            this, SLOT(stepError(QProcess::ProcessError)));
+#endif
+    m_timeout->start(timeout);
+    m_ssh->start(sshProgram(), sshArgs(args));
+}
+
+void SshTunnel::stopStep()
+{
+    m_timeout->stop();
+    if (!m_ssh)
+        return;
+    m_ssh->disconnect(this);
+    m_ssh->kill();
+    m_ssh->deleteLater();
+    m_ssh = Q_NULLPTR;
+}
+
+void SshTunnel::fail(const QString &error)
+{
+    stopStep();
+    m_step = ST_Idle;
+    emit failed(error);
+}
+
+void SshTunnel::stepFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    bool ok = (exitStatus == QProcess::NormalExit && exitCode == 0);
+    QString error = QString::fromLocal8Bit(m_ssh->readAllStandardError()).trimmed();
+    if (error.isEmpty())
+        error = tr("ssh to %1 failed").arg(m_jumpHost);
+    stopStep();
+
+    switch (m_step) {
+    case ST_Idle:
+        break;
+    case ST_Check:
+        if (ok)
+            startForward();
+        else
+            startMaster();
+        break;
+    case ST_Master:
+        if (ok)
+            startForward();
+        else
+            fail(error);
+        break;
+    case ST_Forward:
+        if (!ok) {
+            fail(error);
+            break;
+        }
+        m_step = ST_Idle;
+        m_forwarding = true;
+        emit opened();
+        break;
+    }
+}
+
+void SshTunnel::stepError(QProcess::ProcessError error)
+{
+    // Anything else is followed by finished()
+    if (error == QProcess::FailedToStart)
+        fail(tr("Could not start ssh.  Is it in your PATH?"));
+}
+
+void SshTunnel::stepTimedOut()
+{
+    if (m_step == ST_Check) {
+        // A stale control socket; set up a new master instead
+        stopStep();
+        startMaster();
+        return;
+    }
+    fail(tr("Timed out waiting for ssh to %1").arg(m_jumpHost));
+}
+
+void SshTunnel::startMaster()
+{
+    // ssh backgrounds itself once authenticated
+    runStep(ST_Master, QStringList { QStringLiteral("-o"), QStringLiteral("ControlMaster=yes"),
+                                     QStringLiteral("-o"), QStringLiteral("ControlPersist=10m"),
+                                     QStringLiteral("-N"), QStringLiteral("-f") }, 60000);
+}
+
+void SshTunnel::startForward()
+{
+    // Let the kernel pick a free port for us.  There's a short window
+    // before ssh binds it, but nothing else should be racing us for it.
+    {
+        QTcpServer probe;
+        if (!probe.listen(QHostAddress::LocalHost, 0)) {
+            fail(tr("Could not find a free local port"));
+            return;
+        }
+        m_localPort = probe.serverPort();
+    }
+
+    runStep(ST_Forward, QStringList { QStringLiteral("-O"), QStringLiteral("forward"),
+                                      QStringLiteral("-L"), forwardSpec() }, 10000);
+}
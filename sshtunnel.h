@@ -0,0 +1,88 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _QFREERDP_SSHTUNNEL_H
+#define _QFREERDP_SSHTUNNEL_H
+
+#include <QObject>
+#include <QProcess>
+#include <QStringList>
+
+class QTimer;
+
+/* Port forward through an SSH jump host.  All tunnels to the same jump host
+ * share one persistent master connection, so only the first one pays for
+ * the SSH handshake and authentication.  The forward is cancelled when the
+ * tunnel is destroyed, but the master stays around for a while for reuse.
+ *
+ * ssh runs in batch mode, since there is no terminal to ask for passwords
+ * on; the jump host must accept a key or agent. */
+class SshTunnel : public QObject
+{
+    Q_OBJECT
+
+public:
+    SshTunnel(const QString &jumpHost, const QString &host, quint16 port,
+              QObject *parent = Q_NULLPTR);
+    ~SshTunnel();
+
+    /* Sets up the forward in the background, and emits opened() or
+     * failed() when done */
+    void open();
+    quint16 localPort() const { return m_localPort; }
+
+    /* Leaves the forward in place when the tunnel is destroyed.  It then
+     * goes away with the master connection. */
+    void detach() { m_forwarding = false; }
+
+signals:
+    void opened();
+    void failed(const QString &error);
+
+private slots:
+    void stepFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void stepError(QProcess::ProcessError error);
+    void stepTimedOut();
+
+private:
+    enum Step
+    {
+        ST_Idle,
+        ST_Check,
+        ST_Master,
+        ST_Forward
+    };
+
+    QString m_jumpHost;
+    QString m_host;
+    quint16 m_port;
+    quint16 m_localPort;
+    bool m_forwarding;
+    Step m_step;
+    QProcess *m_ssh;
+    QTimer *m_timeout;
+
+    QString forwardSpec() const;
+    QStringList sshArgs(const QStringList &args) const;
+    void runStep(Step step, const QStringList &args, int timeout);
+    void startMaster();
+    void startForward();
+    void stopStep();
+    void fail(const QString &error);
+};
+
+#endif
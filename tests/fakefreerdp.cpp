@@ -0,0 +1,78 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* A stand-in for xfreerdp, so the launcher can be driven end to end
+ * without a server or a display.  It answers --version and /help like the
+ * real client, and otherwise appends a line with a steady clock timestamp
+ * (microseconds, the same clock as our traces) and its arguments to the
+ * file named by $FAKE_FREERDP_LOG.
+ *
+ * $FAKE_FREERDP_VERSION overrides the reported version, and
+ * $FAKE_FREERDP_SESSION_MS keeps the "session" open for a while. */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+static long long steadyMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char *argv[])
+{
+    const long long started = steadyMicros();
+
+    if (argc == 2 && strcmp(argv[1], "--version") == 0) {
+        const char *version = getenv("FAKE_FREERDP_VERSION");
+        printf("This is FreeRDP version %s (fake)\n", version ? version : "2.11.7");
+        return 0;
+    }
+    if (argc == 2 && strcmp(argv[1], "/help") == 0) {
+        printf("FreeRDP - A Free Remote Desktop Protocol Implementation\n"
+               "\n"
+               "Usage: %s [file] [options] [/v:<server>[:port]]\n"
+               "\n"
+               "This is a stand-in which logs its arguments and exits.\n", argv[0]);
+        return 0;
+    }
+
+    const char *logName = getenv("FAKE_FREERDP_LOG");
+    FILE *log = logName ? fopen(logName, "a") : stderr;
+    if (!log) {
+        perror(logName);
+        return 1;
+    }
+    fprintf(log, "%lld", started);
+    for (int i = 1; i < argc; ++i)
+        fprintf(log, "\t%s", argv[i]);
+    fputc('\n', log);
+    if (log != stderr)
+        fclose(log);
+
+    // What the launcher looks for to tell the session is up
+    printf("[INFO][com.freerdp.gdi] - Local framebuffer format  PIXEL_FORMAT_BGRX32\n");
+    fflush(stdout);
+
+    const char *sessionMsecs = getenv("FAKE_FREERDP_SESSION_MS");
+    if (sessionMsecs)
+        std::this_thread::sleep_for(std::chrono::milliseconds(atoi(sessionMsecs)));
+    return 0;
+}
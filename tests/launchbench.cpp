@@ -0,0 +1,187 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Times a scripted launch end to end: from starting qfreerdp, to the
+ * dialog being shown, to Connect being handled, to the client process
+ * running.  The client is the fakefreerdp stand-in and the dialog is
+ * drawn offscreen, so this needs neither a server nor a display.  Each
+ * run gets its own empty configuration, cache and runtime directories.
+ *
+ * All timestamps come from the steady clock in microseconds: ours, the
+ * spans in qfreerdp's trace, and the one the stand-in logs. */
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QThread>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+static qint64 steadyMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct LaunchTimes
+{
+    qint64 shown;       // Process start to dialog shown
+    qint64 connect;     // Dialog shown to Connect being handled
+    qint64 exec;        // Connect to the client running
+    qint64 total;
+};
+
+static bool spanTimes(const QString &traceFile, const QString &name,
+                      qint64 *start, qint64 *end)
+{
+    QFile file(traceFile);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QJsonArray events = QJsonDocument::fromJson(file.readAll()).object()
+                        .value(QStringLiteral("traceEvents")).toArray();
+    for (const QJsonValue &value : events) {
+        QJsonObject event = value.toObject();
+        if (event.value(QStringLiteral("name")).toString() != name)
+            continue;
+        *start = static_cast<qint64>(event.value(QStringLiteral("ts")).toDouble());
+        *end = *start + static_cast<qint64>(event.value(QStringLiteral("dur")).toDouble());
+        return true;
+    }
+    return false;
+}
+
+static bool launchOnce(const QString &qfreerdp, const QString &client, LaunchTimes *times)
+{
+    QTemporaryDir dir;
+    if (!dir.isValid())
+        return false;
+    QDir root(dir.path());
+    root.mkpath(QStringLiteral("config/qfreerdp"));
+
+    QFile config(root.filePath(QStringLiteral("config/qfreerdp/qfreerdp.conf")));
+    if (!config.open(QIODevice::WriteOnly))
+        return false;
+    config.write("[General]\n"
+                 "CurrentServer=bench.invalid\n"
+                 "Username=bench\n");
+    config.close();
+
+    const QString execLog = root.filePath(QStringLiteral("exec.log"));
+    const QString traceFile = root.filePath(QStringLiteral("trace.json"));
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    env.insert(QStringLiteral("XDG_CONFIG_HOME"), root.filePath(QStringLiteral("config")));
+    env.insert(QStringLiteral("XDG_CACHE_HOME"), root.filePath(QStringLiteral("cache")));
+    env.insert(QStringLiteral("XDG_DATA_HOME"), root.filePath(QStringLiteral("data")));
+    env.insert(QStringLiteral("XDG_RUNTIME_DIR"), dir.path());
+    env.insert(QStringLiteral("QFREERDP_PROFILE_DIR"), root.filePath(QStringLiteral("profiles")));
+    env.insert(QStringLiteral("QFREERDP_XFREERDP"), client);
+    env.insert(QStringLiteral("QFREERDP_TRACE"), traceFile);
+    env.insert(QStringLiteral("FAKE_FREERDP_LOG"), execLog);
+    env.insert(QStringLiteral("QT_QPA_PLATFORM"), QStringLiteral("offscreen"));
+
+    QProcess proc;
+    proc.setProcessEnvironment(env);
+    proc.setProcessChannelMode(QProcess::ForwardedChannels);
+    const qint64 started = steadyMicros();
+    proc.start(qfreerdp, QStringList { QStringLiteral("--connect") });
+    if (!proc.waitForStarted()) {
+        fprintf(stderr, "Could not start %s\n", qfreerdp.toLocal8Bit().constData());
+        return false;
+    }
+    proc.write("bench\n");
+    proc.closeWriteChannel();
+    if (!proc.waitForFinished(30000) || proc.exitCode() != 0) {
+        fputs("qfreerdp did not finish cleanly\n", stderr);
+        return false;
+    }
+
+    // The client is started detached, so it may still be writing
+    QFile log(execLog);
+    QElapsedTimer timer;
+    timer.start();
+    while (!log.exists() && timer.elapsed() < 5000)
+        QThread::msleep(5);
+    if (!log.open(QIODevice::ReadOnly)) {
+        fputs("The client was never started\n", stderr);
+        return false;
+    }
+    const qint64 executed = log.readLine().split('\t').first().toLongLong();
+
+    qint64 shownStart, shown, connect, connectEnd;
+    if (!spanTimes(traceFile, QStringLiteral("startup"), &shownStart, &shown)
+            || !spanTimes(traceFile, QStringLiteral("Launcher::startXFreeRDP"),
+                          &connect, &connectEnd)) {
+        fputs("Trace is missing the startup or connect span\n", stderr);
+        return false;
+    }
+
+    times->shown = shown - started;
+    times->connect = connect - shown;
+    times->exec = executed - connect;
+    times->total = executed - started;
+    return true;
+}
+
+static void printPhase(const char *name, QList<qint64> values)
+{
+    std::sort(values.begin(), values.end());
+    printf("%-18s %10.2f %10.2f %10.2f\n", name, values.first() / 1e3,
+           values[values.size() / 2] / 1e3, values.last() / 1e3);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <qfreerdp> <fakefreerdp> [runs]\n", argv[0]);
+        return 2;
+    }
+    const QString qfreerdp = QString::fromLocal8Bit(argv[1]);
+    const QString client = QString::fromLocal8Bit(argv[2]);
+    const int runs = (argc > 3) ? atoi(argv[3]) : 10;
+    if (runs < 1) {
+        fprintf(stderr, "Invalid number of runs: %s\n", argv[3]);
+        return 2;
+    }
+
+    QList<qint64> shown, connect, exec, total;
+    for (int i = 0; i < runs; ++i) {
+        LaunchTimes times;
+        if (!launchOnce(qfreerdp, client, &times))
+            return 1;
+        shown.append(times.shown);
+        connect.append(times.connect);
+        exec.append(times.exec);
+        total.append(times.total);
+    }
+
+    printf("%d runs\n", runs);
+    printf("%-18s %10s %10s %10s\n", "phase", "min ms", "median ms", "max ms");
+    printPhase("start to dialog", shown);
+    printPhase("dialog to connect", connect);
+    printPhase("connect to client", exec);
+    printPhase("total", total);
+    return 0;
+}
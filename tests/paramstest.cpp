@@ -0,0 +1,201 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Checks the command lines built for each FreeRDP version against a
+ * golden file.  Run with QFREERDP_UPDATE_GOLDEN=1 to rewrite it after an
+ * intended change, and review the diff. */
+
+#include "params.h"
+#include <QFile>
+#include <QTextStream>
+#include <cstdio>
+
+static ConnectionSettings baseSettings()
+{
+    ConnectionSettings connection;
+    connection.server = QStringLiteral("rdp.example.com");
+    connection.username = QStringLiteral("alice");
+    connection.password = QStringLiteral("secret");
+    connection.standardSize = QSize(1920, 1080);
+    return connection;
+}
+
+static QList<QPair<QString, ConnectionSettings>> testCases()
+{
+    QList<QPair<QString, ConnectionSettings>> cases;
+
+    cases.append(qMakePair(QStringLiteral("defaults"), baseSettings()));
+
+    ConnectionSettings tunneled = baseSettings();
+    tunneled.server = QStringLiteral("[fe80::1]:3390");
+    tunneled.target = QStringLiteral("127.0.0.1:40000");
+    tunneled.certFingerprint = QStringLiteral("0123abcd");
+    tunneled.resolutionType = RT_Custom;
+    tunneled.customSize = QSize(1280, 800);
+    tunneled.bpp = 16;
+    tunneled.compression = CT_Disabled;
+    tunneled.jpeg = true;
+    tunneled.jpegQuality = 80;
+    tunneled.audioMode = 1;
+    tunneled.clipboard = false;
+    tunneled.redirectDrives = true;
+    tunneled.redirectHome = true;
+    tunneled.wallpaper = false;
+    tunneled.fontSmoothing = false;
+    tunneled.aero = false;
+    tunneled.windowDrag = false;
+    tunneled.menuAnims = false;
+    tunneled.themes = false;
+    tunneled.bitmapCache = false;
+    tunneled.offscreenCache = false;
+    tunneled.glyphCache = false;
+    cases.append(qMakePair(QStringLiteral("tunneled"), tunneled));
+
+    ConnectionSettings remoteApp = baseSettings();
+    remoteApp.server = QStringLiteral("apps.example.com");
+    remoteApp.resolutionType = RT_RemoteApp;
+    remoteApp.remoteApp = QStringLiteral("||notepad");
+    remoteApp.remoteAppArgs = QStringLiteral("notes.txt");
+    remoteApp.remoteAppDirectory = QStringLiteral("C:\\Temp");
+    remoteApp.compression = CT_Level + 2;
+    remoteApp.gateway = QStringLiteral("gw.example.com");
+    remoteApp.gatewayUsername = QStringLiteral("bob");
+    remoteApp.gatewayPassword = QStringLiteral("hunter2");
+    remoteApp.extraParams = QStringLiteral("/log-level:WARN \"/t:My Title\" +auto-reconnect");
+    cases.append(qMakePair(QStringLiteral("remoteapp"), remoteApp));
+
+    ConnectionSettings capture = baseSettings();
+    capture.server = QStringLiteral("rdp.example.com:3390");
+    capture.resolutionType = RT_Fullscreen;
+    capture.bpp = 24;
+    capture.glyphCache = false;
+    capture.captureFile = QStringLiteral("/tmp/rdp.pcap");
+    cases.append(qMakePair(QStringLiteral("capture"), capture));
+
+    return cases;
+}
+
+static QList<QPair<QString, ConnectionSettings>> validationCases()
+{
+    QList<QPair<QString, ConnectionSettings>> cases;
+
+    ConnectionSettings noServer = baseSettings();
+    noServer.server.clear();
+    cases.append(qMakePair(QStringLiteral("no-server"), noServer));
+
+    ConnectionSettings noPassword = baseSettings();
+    noPassword.password.clear();
+    cases.append(qMakePair(QStringLiteral("no-password"), noPassword));
+
+    ConnectionSettings tinyCustom = baseSettings();
+    tinyCustom.resolutionType = RT_Custom;
+    tinyCustom.customSize = QSize(99, 600);
+    cases.append(qMakePair(QStringLiteral("tiny-custom"), tinyCustom));
+
+    ConnectionSettings noProgram = baseSettings();
+    noProgram.resolutionType = RT_RemoteApp;
+    cases.append(qMakePair(QStringLiteral("no-program"), noProgram));
+
+    // Fine as a separate argument, but would split a FreeRDP 3 /app: list
+    ConnectionSettings commaArgs = baseSettings();
+    commaArgs.resolutionType = RT_RemoteApp;
+    commaArgs.remoteApp = QStringLiteral("||excel");
+    commaArgs.remoteAppArgs = QStringLiteral("/e,/r");
+    cases.append(qMakePair(QStringLiteral("comma-args"), commaArgs));
+
+    ConnectionSettings commaPassword = baseSettings();
+    commaPassword.gateway = QStringLiteral("gw.example.com");
+    commaPassword.gatewayUsername = QStringLiteral("bob");
+    commaPassword.gatewayPassword = QStringLiteral("a,b");
+    cases.append(qMakePair(QStringLiteral("comma-password"), commaPassword));
+
+    // Only the RemoteApp settings in use are passed on
+    ConnectionSettings unusedComma = baseSettings();
+    unusedComma.remoteAppDirectory = QStringLiteral("C:\\a,b");
+    cases.append(qMakePair(QStringLiteral("unused-comma"), unusedComma));
+
+    return cases;
+}
+
+static QString render()
+{
+    QString result;
+    QTextStream out(&result);
+    for (const auto &test : testCases()) {
+        for (int major : { 2, 3 }) {
+            QString error;
+            if (!validateSettings(test.second, major, &error)) {
+                out << "[" << test.first << " " << major << "] invalid: " << error << "\n\n";
+                continue;
+            }
+            out << "[" << test.first << " " << major << "]\n";
+            for (const QString &param : clientParams(test.second, major))
+                out << param << "\n";
+            out << "\n";
+        }
+    }
+    for (const auto &test : validationCases()) {
+        for (int major : { 2, 3 }) {
+            QString error;
+            if (validateSettings(test.second, major, &error))
+                error = QStringLiteral("ok");
+            out << "[" << test.first << " " << major << "] " << error << "\n";
+        }
+    }
+    out.flush();
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <golden file>\n", argv[0]);
+        return 2;
+    }
+
+    QFile golden(QString::fromLocal8Bit(argv[1]));
+    QString actual = render();
+    if (!qgetenv("QFREERDP_UPDATE_GOLDEN").isEmpty()) {
+        if (!golden.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            fprintf(stderr, "Could not write %s\n", argv[1]);
+            return 2;
+        }
+        golden.write(actual.toUtf8());
+        return 0;
+    }
+
+    if (!golden.open(QIODevice::ReadOnly)) {
+        fprintf(stderr, "Could not read %s\n", argv[1]);
+        return 2;
+    }
+    QString expected = QString::fromUtf8(golden.readAll());
+    if (actual == expected)
+        return 0;
+
+    QStringList expectedLines = expected.split(QLatin1Char('\n'));
+    QStringList actualLines = actual.split(QLatin1Char('\n'));
+    for (int i = 0; i < qMax(expectedLines.size(), actualLines.size()); ++i) {
+        QString want = expectedLines.value(i);
+        QString got = actualLines.value(i);
+        if (want != got) {
+            fprintf(stderr, "%s:%d: expected \"%s\", got \"%s\"\n", argv[1], i + 1,
+                    want.toUtf8().constData(), got.toUtf8().constData());
+            break;
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,96 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "trace.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* This deliberately avoids Qt, since spans may be recorded before the
+ * application object exists and are written out after it's gone */
+
+bool g_traceEnabled = false;
+
+struct TraceEvent
+{
+    const char *name;
+    int64_t start;
+    int64_t duration;
+    long tid;
+};
+
+static const char *s_tracePath;
+static std::mutex s_traceLock;
+static std::vector<TraceEvent> s_traceEvents;
+
+static void writeTrace()
+{
+    // An invocation which only forwarded to the resident instance has
+    // nothing to say, and mustn't clobber a trace from one which did
+    std::lock_guard<std::mutex> lock(s_traceLock);
+    if (s_traceEvents.empty())
+        return;
+
+    FILE *out = fopen(s_tracePath, "w");
+    if (!out) {
+        fprintf(stderr, "Could not write trace to %s\n", s_tracePath);
+        return;
+    }
+
+    const long pid = static_cast<long>(getpid());
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", out);
+    fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%ld,"
+                 "\"args\":{\"name\":\"qfreerdp\"}}", pid, pid);
+    for (const TraceEvent &event : s_traceEvents) {
+        // Span names are string literals, so they need no escaping
+        fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,"
+                     "\"pid\":%ld,\"tid\":%ld}",
+                event.name, static_cast<long long>(event.start),
+                static_cast<long long>(event.duration), pid, event.tid);
+    }
+    fputs("\n]}\n", out);
+    fclose(out);
+}
+
+void initTrace()
+{
+    s_tracePath = getenv("QFREERDP_TRACE");
+    if (!s_tracePath || !*s_tracePath)
+        return;
+    s_traceEvents.reserve(256);
+    atexit(writeTrace);
+    g_traceEnabled = true;
+}
+
+int64_t traceClock()
+{
+    // Microseconds, as the trace format expects
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void traceSpan(const char *name, int64_t start, int64_t end)
+{
+    TraceEvent event { name, start, end - start, syscall(SYS_gettid) };
+    std::lock_guard<std::mutex> lock(s_traceLock);
+    s_traceEvents.push_back(event);
+}
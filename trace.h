@@ -0,0 +1,61 @@
+/* This file is part of qfreerdp.
+ *
+ * qfreerdp is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * qfreerdp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with qfreerdp; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _QFREERDP_TRACE_H
+#define _QFREERDP_TRACE_H
+
+#include <cstdint>
+
+/* Scoped timing spans, written as a Chrome trace (chrome://tracing or
+ * ui.perfetto.dev) to the file named by $QFREERDP_TRACE when we exit, if
+ * any were recorded.  A resident instance exits cleanly on SIGTERM, so it
+ * writes one too.  When that isn't set, a span costs one branch on a
+ * global flag. */
+
+extern bool g_traceEnabled;
+
+/* Call first thing in main() */
+void initTrace();
+
+int64_t traceClock();
+void traceSpan(const char *name, int64_t start, int64_t end);
+
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name)
+        : m_name(name), m_start(g_traceEnabled ? traceClock() : 0) { }
+
+    ~TraceScope()
+    {
+        if (g_traceEnabled)
+            traceSpan(m_name, m_start, traceClock());
+    }
+
+private:
+    const char *m_name;
+    int64_t m_start;
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(_trace_, __LINE__)(name)
+
+#endif